@@ -9,3 +9,8 @@ DISTFILES += \
 
 SUBDIRS += \
     sailfishos
+
+# build the checks with qmake CONFIG+=tests and run them with make check
+CONFIG(tests) {
+    SUBDIRS += tests
+}
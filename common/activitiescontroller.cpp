@@ -20,6 +20,7 @@
 #include "activitiescontroller.h"
 #include "category.h"
 #include "activity.h"
+#include "registry.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
@@ -57,29 +58,27 @@ int ActivitiesController::add(const QString &name, Category *c, int minRepeats,
         return -1;
     }
 
-    Category *cat = new Category(c);
+    Category *cat = Registry::instance()->intern(c);
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("activities_insert"), QStringLiteral("INSERT INTO activities (name, category, minrepeats, maxrepeats, distance, sensor, sensorDelay) VALUES (?, ?, ?, ?, ?, ?, ?)"));
 
-    if (!q.prepare(QStringLiteral("INSERT INTO activities (name, category, minrepeats, maxrepeats, distance, sensor, sensorDelay) VALUES (?, ?, ?, ?, ?, ?, ?)"))) {
-        delete cat;
+    if (!q) {
         return -1;
     }
 
-    q.addBindValue(name);
-    q.addBindValue(cat->databaseId());
-    q.addBindValue(minRepeats);
-    q.addBindValue(maxRepeats);
-    q.addBindValue(useDistance);
-    q.addBindValue(sensorType);
-    q.addBindValue(sensorDelay);
+    q->addBindValue(name);
+    q->addBindValue(cat->databaseId());
+    q->addBindValue(minRepeats);
+    q->addBindValue(maxRepeats);
+    q->addBindValue(useDistance);
+    q->addBindValue(sensorType);
+    q->addBindValue(sensorDelay);
 
-    if (!q.exec()) {
-        delete cat;
+    if (!q->exec()) {
         return -1;
     }
 
-    int id = q.lastInsertId().toInt();
+    int id = q->lastInsertId().toInt();
 
     emit added(id, name, cat, minRepeats, maxRepeats, useDistance, sensorType, sensorDelay);
 
@@ -105,22 +104,22 @@ bool ActivitiesController::update(Activity *a, int oldCategoryId)
         return false;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("activities_update"), QStringLiteral("UPDATE activities SET name = ?, category = ?, minRepeats = ?, maxRepeats = ?, distance = ?, sensor = ?, sensorDelay = ? WHERE id = ?"));
 
-    if (!q.prepare(QStringLiteral("UPDATE activities SET name = ?, category = ?, minRepeats = ?, maxRepeats = ?, distance = ?, sensor = ?, sensorDelay = ? WHERE id = ?"))) {
+    if (!q) {
         return false;
     }
 
-    q.addBindValue(a->name());
-    q.addBindValue(a->category()->databaseId());
-    q.addBindValue(a->minRepeats());
-    q.addBindValue(a->maxRepeats());
-    q.addBindValue(a->useDistance());
-    q.addBindValue(a->sensorType());
-    q.addBindValue(a->sensorDelay());
-    q.addBindValue(a->databaseId());
+    q->addBindValue(a->name());
+    q->addBindValue(a->category()->databaseId());
+    q->addBindValue(a->minRepeats());
+    q->addBindValue(a->maxRepeats());
+    q->addBindValue(a->useDistance());
+    q->addBindValue(a->sensorType());
+    q->addBindValue(a->sensorDelay());
+    q->addBindValue(a->databaseId());
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         return false;
     }
 
@@ -141,15 +140,15 @@ bool ActivitiesController::remove(Activity *a)
         return false;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("activities_delete"), QStringLiteral("DELETE FROM activities WHERE id = ?"));
 
-    if (!q.prepare(QStringLiteral("DELETE FROM activities WHERE id = ?"))) {
+    if (!q) {
         return false;
     }
 
-    q.addBindValue(a->databaseId());
+    q->addBindValue(a->databaseId());
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         return false;
     }
 
@@ -24,6 +24,7 @@
 #include "category.h"
 #include "activity.h"
 #include "record.h"
+#include "registry.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #ifdef QT_DEBUG
@@ -43,6 +44,8 @@ ActivitiesModel::ActivitiesModel(QObject *parent) : DBModel(parent)
     m_catsController = nullptr;
     m_recsController = nullptr;
     init();
+
+    connect(Registry::instance(), &Registry::reloaded, this, &ActivitiesModel::init);
 }
 
 
@@ -114,34 +117,41 @@ QVariant ActivitiesModel::data(const QModelIndex &index, int role) const
 
 
 
+/*!
+ * \brief Returns the query that loads all activities together with their categories.
+ */
+QString ActivitiesModel::loadQuery()
+{
+    return QStringLiteral("SELECT a.id, a.name, a.minrepeats, a.maxrepeats, a.distance, a.category, c.name as categoryname, c.color, a.record_count, c.activity_count, a.sensor, a.sensorDelay FROM activities a JOIN categories c ON c.id = a.category");
+}
+
+
+
 /*!
  * \brief Initializes the model data from the SQL database.
  */
 void ActivitiesModel::init()
 {
-    setInOperation(true);
+    startQuery(loadQuery());
+}
 
-    clear();
 
-    if (!connectDb()) {
-        setInOperation(false);
-        return;
-    }
-
-    QSqlQuery q(m_db);
 
-    if (!q.exec(QStringLiteral("SELECT a.id, a.name, a.minrepeats, a.maxrepeats, a.distance, a.category, c.name as categoryname, c.color, (SELECT COUNT(id) FROM records WHERE activity = a.id) AS records, (SELECT COUNT(id) FROM activities WHERE category = a.category) AS catActs, a.sensor, a.sensorDelay FROM activities a JOIN categories c ON c.id = a.category"))) {
-        setInOperation(false);
-        return;
-    }
+/*!
+ * \brief Populates the model with the loaded activities.
+ */
+void ActivitiesModel::queryFinished(const DBRows &rows)
+{
+    clear();
 
     QList<Activity*> t_activities;
+    t_activities.reserve(rows.size());
+
+    Registry *registry = Registry::instance();
 
-    while (q.next()) {
-        Activity *a = new Activity(q.value(0).toInt(), q.value(1).toString(), q.value(2).toInt(), q.value(3).toInt(), q.value(4).toBool(), q.value(8).toInt(), q.value(10).toInt(), q.value(11).toInt(), this);
-        Category *c = new Category(q.value(5).toInt(), q.value(6).toString(), q.value(7).toString(), q.value(9).toInt(), a);
-        a->setCategory(c);
-        t_activities.append(a);
+    for (const QVariantList &row : rows) {
+        Category *c = registry->category(row.at(5).toInt(), row.at(6).toString(), row.at(7).toString(), row.at(9).toInt());
+        t_activities.append(registry->activity(row.at(0).toInt(), row.at(1).toString(), row.at(2).toInt(), row.at(3).toInt(), row.at(4).toBool(), row.at(8).toInt(), row.at(10).toInt(), row.at(11).toInt(), c));
     }
 
     if (!t_activities.isEmpty()) {
@@ -149,25 +159,26 @@ void ActivitiesModel::init()
         beginInsertRows(QModelIndex(), 0, t_activities.count()-1);
 
         m_activities = t_activities;
+        reindex(0);
 
         endInsertRows();
     }
-
-    setInOperation(false);
 }
 
 
 
 /*!
  * \brief Clears the model and removes all model data.
+ *
+ * The Activity objects are owned by the Registry and will not be destroyed.
  */
 void ActivitiesModel::clear()
 {
     if (!m_activities.isEmpty()) {
         beginRemoveRows(QModelIndex(), 0, rowCount()-1);
 
-        qDeleteAll(m_activities);
         m_activities.clear();
+        m_rows.clear();
 
         endRemoveRows();
     }
@@ -180,13 +191,17 @@ void ActivitiesModel::clear()
  */
 void ActivitiesModel::add(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool distance, int sensorType, int sensorDelay)
 {
-    Activity *a = new Activity(databaseId, name, minRepeats, maxRepeats, distance, 0, sensorType, sensorDelay, this);
-    c->setParent(a);
-    a->setCategory(c);
+    Registry *registry = Registry::instance();
+
+    Activity *a = registry->activity(databaseId);
+    if (!a) {
+        a = registry->activity(databaseId, name, minRepeats, maxRepeats, distance, 0, sensorType, sensorDelay, registry->intern(c));
+    }
 
     beginInsertRows(QModelIndex(), rowCount(), rowCount());
 
     m_activities.append(a);
+    m_rows.insert(a->databaseId(), m_activities.size()-1);
 
     endInsertRows();
 }
@@ -209,7 +224,9 @@ void ActivitiesModel::remove(int databaseId, int category)
 
     beginRemoveRows(QModelIndex(), idx, idx);
 
-    delete m_activities.takeAt(idx);
+    m_activities.removeAt(idx);
+    m_rows.remove(databaseId);
+    reindex(idx);
 
     endRemoveRows();
 }
@@ -238,54 +255,25 @@ void ActivitiesModel::removeCategory(int category)
 
 
 /*!
- * \brief Updates the model items after a Category has been updated.
+ * \brief Returns the index of the model item identified by databaseId.
+ *
+ * If the item is not in the model, \a -1 will be returned.
  */
-void ActivitiesModel::updateCategory(Category *c)
+int ActivitiesModel::find(int databaseId)
 {
-    if (m_activities.isEmpty()) {
-        return;
-    }
-
-    if (!c) {
-        return;
-    }
-
-    if (!c->isValid()) {
-        return;
-    }
-
-    for (int i = 0; i < m_activities.size(); ++i) {
-        Category *cat = m_activities.at(i)->category();
-        if (cat->databaseId() == c->databaseId()) {
-            cat->setName(c->name());
-            cat->setColor(c->color());
-        }
-    }
+    return m_rows.value(databaseId, -1);
 }
 
 
 
 /*!
- * \brief Returns the index of the model item identified by databaseId.
- *
- * If the item is not in the model, \a -1 will be returned.
+ * \brief Updates the row index of the model items starting at \a row.
  */
-int ActivitiesModel::find(int databaseId)
+void ActivitiesModel::reindex(int row)
 {
-    int idx = -1;
-
-    if (m_activities.isEmpty()) {
-        return idx;
+    for (int i = row; i < m_activities.size(); ++i) {
+        m_rows.insert(m_activities.at(i)->databaseId(), i);
     }
-
-    for (int i = 0; i < m_activities.size(); ++i) {
-        if (m_activities.at(i)->databaseId() == databaseId) {
-            idx = i;
-            break;
-        }
-    }
-
-    return idx;
 }
 
 
@@ -330,13 +318,11 @@ void ActivitiesModel::setCategoriesController(CategoriesController *controller)
         if (m_catsController) {
             disconnect(m_catsController, &CategoriesController::removed, this, &ActivitiesModel::removeCategory);
             disconnect(m_catsController, &CategoriesController::removedAll, this, &ActivitiesModel::removeAll);
-            disconnect(m_catsController, &CategoriesController::updated, this, &ActivitiesModel::updateCategory);
         }
         m_catsController = controller;
         if (m_catsController) {
             connect(m_catsController, &CategoriesController::removed, this, &ActivitiesModel::removeCategory);
             connect(m_catsController, &CategoriesController::removedAll, this, &ActivitiesModel::removeAll);
-            connect(m_catsController, &CategoriesController::updated, this, &ActivitiesModel::updateCategory);
         }
     }
 }
@@ -356,22 +342,7 @@ CategoriesController *ActivitiesModel::getCategoriesController() const
  */
 void ActivitiesModel::setRecordsController(RecordsController *controller)
 {
-    if (controller != m_recsController) {
-
-        if (m_recsController) {
-            disconnect(m_recsController, &RecordsController::removed, this, &ActivitiesModel::recordRemoved);
-            disconnect(m_recsController, &RecordsController::removedByActivity, this, &ActivitiesModel::recordsRemovedByActivity);
-            disconnect(m_recsController, &RecordsController::removedByCategory, this, &ActivitiesModel::recordsRemovedByCategory);
-            disconnect(m_recsController, &RecordsController::finished, this, &ActivitiesModel::recordFinished);
-        }
-        m_recsController = controller;
-        if (m_recsController) {
-            connect(m_recsController, &RecordsController::removed, this, &ActivitiesModel::recordRemoved);
-            connect(m_recsController, &RecordsController::removedByActivity, this, &ActivitiesModel::recordsRemovedByActivity);
-            connect(m_recsController, &RecordsController::removedByCategory, this, &ActivitiesModel::recordsRemovedByCategory);
-            connect(m_recsController, &RecordsController::finished, this, &ActivitiesModel::recordFinished);
-        }
-    }
+    m_recsController = controller;
 }
 
 
@@ -382,81 +353,3 @@ RecordsController *ActivitiesModel::getRecordsController() const
 {
     return m_recsController;
 }
-
-
-
-
-/*!
- * \brief Updates the records count of the \c activity after a records has been removed.
- */
-void ActivitiesModel::recordRemoved(int record, int activity, int category)
-{
-    Q_UNUSED(record)
-    Q_UNUSED(category)
-
-    int idx = find(activity);
-
-    if (idx < 0) {
-        return;
-    }
-
-    Activity *a = m_activities.at(idx);
-
-    a->setRecords(a->records()-1);
-}
-
-
-
-/*!
- * \brief Updates the records count of \c activity after all records of that activity have been removed.
- */
-void ActivitiesModel::recordsRemovedByActivity(int activity, int category)
-{
-    Q_UNUSED(category)
-
-    int idx = find(activity);
-
-    if (idx < 0) {
-        return;
-    }
-
-    m_activities.at(idx)->setRecords(0);
-}
-
-
-/*!
- * \brief Updates the records count of activities belonging to \c category after the records of that category have been removed.
- */
-void ActivitiesModel::recordsRemovedByCategory(int category)
-{
-    if (m_activities.isEmpty()) {
-        return;
-    }
-
-    for (int i = 0; i < m_activities.size(); ++i) {
-        if (m_activities.at(i)->category()->databaseId() == category) {
-            m_activities.at(i)->setRecords(0);
-        }
-    }
-}
-
-
-/*!
- * \brief Updates the record count after a record has been finished.
- */
-void ActivitiesModel::recordFinished(Record *r)
-{
-    if (m_activities.isEmpty()) {
-        return;
-    }
-
-    int idx = find(r->activity()->databaseId());
-
-    if (idx < 0) {
-        return;
-    }
-
-    Activity *a = m_activities.at(idx);
-
-    a->setRecords(a->records() + 1);
-}
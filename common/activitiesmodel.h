@@ -35,7 +35,8 @@ class Record;
 /*!
  * \brief Model containing a set of Activity objects.
  *
- * On cunstruction, the model will load all available data from the SQL database, no further actions are needed.
+ * On cunstruction, the model will load all available data from the SQL database in the background, no further actions are needed.
+ * The model items are the canonical Activity objects from the Registry, the records counts are maintained by the Registry.
  */
 class ActivitiesModel : public DBModel
 {
@@ -67,26 +68,25 @@ public:
     void setRecordsController(RecordsController *controller);
     RecordsController *getRecordsController() const;
 
+    static QString loadQuery();
+
 public slots:
     void add(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool distance, int sensorType, int sensorDelay);
     void remove(int databaseId, int category);
     void removeAll();
 
-    void updateCategory(Category *c);
     void removeCategory(int category);
 
-    void recordRemoved(int record, int activity, int category);
-    void recordsRemovedByActivity(int activity, int category);
-    void recordsRemovedByCategory(int category);
-    void recordFinished(Record *r);
-
 private:
     QList<Activity*> m_activities;
+    QHash<int, int> m_rows;
 
     void init();
+    void queryFinished(const DBRows &rows) Q_DECL_OVERRIDE;
     void clear();
 
     int find(int databaseId);
+    void reindex(int row);
 
     ActivitiesController *m_actsController;
     CategoriesController *m_catsController;
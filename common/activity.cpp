@@ -40,6 +40,11 @@ Activity::Activity(QObject *parent) :
     m_category = nullptr;
     m_sensorType = 0;
     m_sensorDelay = 0;
+    m_bestDistance = 0.0;
+    m_bestRepetitions = 0;
+    m_bestTpr = 0.0f;
+    m_bestSpeed = 0.0f;
+    m_hasPersonalBests = false;
 
 #ifdef QT_DEBUG
     qDebug() << "Constructed a new empty" << this;
@@ -50,7 +55,7 @@ Activity::Activity(QObject *parent) :
  * \overload
  */
 Activity::Activity(int databaseId, const QString &name, int minRepeats, int maxRepeats, bool useDistance, int records, int sensorType, int sensorDelay, QObject *parent) :
-    QObject(parent), m_databaseId(databaseId), m_name(name), m_minRepeats(minRepeats), m_maxRepeats(maxRepeats), m_useDistance(useDistance), m_records(records), m_sensorType(sensorType), m_sensorDelay(sensorDelay)
+    QObject(parent), m_databaseId(databaseId), m_name(name), m_minRepeats(minRepeats), m_maxRepeats(maxRepeats), m_useDistance(useDistance), m_records(records), m_sensorType(sensorType), m_sensorDelay(sensorDelay), m_bestDistance(0.0), m_bestRepetitions(0), m_bestTpr(0.0f), m_bestSpeed(0.0f), m_hasPersonalBests(false)
 {
     m_useRepeats = (minRepeats > 0 && maxRepeats > 0);
 
@@ -66,7 +71,7 @@ Activity::Activity(int databaseId, const QString &name, int minRepeats, int maxR
  * This will create a deep copy. Copying every member data from the \c other Activity to the new Activity.
  */
 Activity::Activity(Activity *other, QObject *parent) :
-    QObject(parent), m_databaseId(other->databaseId()), m_name(other->name()), m_minRepeats(other->minRepeats()), m_maxRepeats(other->maxRepeats()), m_useDistance(other->useDistance()), m_records(other->records()), m_sensorType(other->sensorType()), m_sensorDelay(other->sensorDelay())
+    QObject(parent), m_databaseId(other->databaseId()), m_name(other->name()), m_minRepeats(other->minRepeats()), m_maxRepeats(other->maxRepeats()), m_useDistance(other->useDistance()), m_records(other->records()), m_sensorType(other->sensorType()), m_sensorDelay(other->sensorDelay()), m_bestDistance(other->bestDistance()), m_bestRepetitions(other->bestRepetitions()), m_bestTpr(other->bestTpr()), m_bestSpeed(other->bestSpeed()), m_hasPersonalBests(other->hasPersonalBests())
 {
     m_useRepeats = (other->minRepeats() > 0 && other->maxRepeats() > 0);
 
@@ -461,6 +466,116 @@ void Activity::setSensorDelay(int nSensorDelay)
 
 
 
+/*!
+ * \property Activity::bestDistance
+ * \brief The longest distance of the finished records of this activity, \c 0 if there is none.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>double</TD><TD>bestDistance() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>personalBestsChanged()</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link Activity::bestDistance bestDistance \endlink property.
+ */
+double Activity::bestDistance() const { return m_bestDistance; }
+
+
+/*!
+ * \property Activity::bestRepetitions
+ * \brief The most repetitions of the finished records of this activity, \c 0 if there is none.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>bestRepetitions() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>personalBestsChanged()</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link Activity::bestRepetitions bestRepetitions \endlink property.
+ */
+int Activity::bestRepetitions() const { return m_bestRepetitions; }
+
+
+/*!
+ * \property Activity::bestTpr
+ * \brief The lowest time per repetition of the finished records of this activity, \c 0 if there is none.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>float</TD><TD>bestTpr() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>personalBestsChanged()</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link Activity::bestTpr bestTpr \endlink property.
+ */
+float Activity::bestTpr() const { return m_bestTpr; }
+
+
+/*!
+ * \property Activity::bestSpeed
+ * \brief The top speed of the finished records of this activity, \c 0 if there is none.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>float</TD><TD>bestSpeed() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>personalBestsChanged()</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link Activity::bestSpeed bestSpeed \endlink property.
+ */
+float Activity::bestSpeed() const { return m_bestSpeed; }
+
+
+/*!
+ * \fn void Activity::personalBestsChanged()
+ * \brief Notifier signal of the personal best properties.
+ */
+
+/*!
+ * \brief Returns true if the personal bests have been loaded from the database.
+ */
+bool Activity::hasPersonalBests() const { return m_hasPersonalBests; }
+
+/*!
+ * \brief Sets the personal bests of this activity, use \c 0 for metrics without a best value.
+ *
+ * The personal bests are loaded and updated by the RecordsController through PersonalBests.
+ */
+void Activity::setPersonalBests(double distance, int repetitions, float tpr, float speed)
+{
+    const bool changed = (distance != m_bestDistance || repetitions != m_bestRepetitions || tpr != m_bestTpr || speed != m_bestSpeed);
+
+    m_bestDistance = distance;
+    m_bestRepetitions = repetitions;
+    m_bestTpr = tpr;
+    m_bestSpeed = speed;
+    m_hasPersonalBests = true;
+
+    if (changed) {
+#ifdef QT_DEBUG
+        qDebug() << "Changed personal bests to" << m_bestDistance << m_bestRepetitions << m_bestTpr << m_bestSpeed;
+#endif
+        emit personalBestsChanged();
+    }
+}
+
+
+/*!
+ * \brief Clears the personal bests, they will be loaded again from the database on next use.
+ */
+void Activity::resetPersonalBests()
+{
+    setPersonalBests(0.0, 0, 0.0f, 0.0f);
+    m_hasPersonalBests = false;
+}
+
+
+
+
 /*!
  * \brief Returns true if this is a valid Activity object.
  *
@@ -45,9 +45,13 @@ class Activity : public QObject
     Q_PROPERTY(bool useRepeats READ useRepeats NOTIFY useRepeatsChanged)
     Q_PROPERTY(bool useDistance READ useDistance WRITE setUseDistance NOTIFY useDistanceChanged)
     Q_PROPERTY(int records READ records NOTIFY recordsChanged)
-    Q_PROPERTY(Gibrievida::Category *category READ category NOTIFY categoryChanged)
+    Q_PROPERTY(Gibrievida::Category *category READ category WRITE setCategory NOTIFY categoryChanged)
     Q_PROPERTY(int sensorType READ sensorType WRITE setSensorType NOTIFY sensorTypeChanged)
     Q_PROPERTY(int sensorDelay READ sensorDelay WRITE setSensorDelay NOTIFY sensorDelayChanged)
+    Q_PROPERTY(double bestDistance READ bestDistance NOTIFY personalBestsChanged)
+    Q_PROPERTY(int bestRepetitions READ bestRepetitions NOTIFY personalBestsChanged)
+    Q_PROPERTY(float bestTpr READ bestTpr NOTIFY personalBestsChanged)
+    Q_PROPERTY(float bestSpeed READ bestSpeed NOTIFY personalBestsChanged)
 public:
     explicit Activity(QObject *parent = nullptr);
     explicit Activity(int databaseId, const QString &name, int minRepeats, int maxRepeats, bool useDistance, int records, int sensorType, int sensorDelay, QObject *parent = nullptr);
@@ -64,6 +68,11 @@ public:
     Category *category() const;
     int sensorType() const;
     int sensorDelay() const;
+    double bestDistance() const;
+    int bestRepetitions() const;
+    float bestTpr() const;
+    float bestSpeed() const;
+    bool hasPersonalBests() const;
 
     void setDatabaseId(int nDatabaseId);
     void setName(const QString &nName);
@@ -75,6 +84,8 @@ public:
     void setCategory(Category *nCategory);
     void setSensorType(int nSensorType);
     void setSensorDelay(int nSensorDelay);
+    void setPersonalBests(double distance, int repetitions, float tpr, float speed);
+    void resetPersonalBests();
 
     Q_INVOKABLE bool isValid() const;
 
@@ -90,6 +101,7 @@ signals:
     void categoryChanged(Category *category);
     void sensorTypeChanged(int sensorType);
     void sensorDelayChanged(int sensorDelay);
+    void personalBestsChanged();
 
 private:
     Q_DISABLE_COPY(Activity)
@@ -103,6 +115,11 @@ private:
     Category *m_category;
     int m_sensorType;
     int m_sensorDelay;
+    double m_bestDistance;
+    int m_bestRepetitions;
+    float m_bestTpr;
+    float m_bestSpeed;
+    bool m_hasPersonalBests;
 };
 
 }
@@ -0,0 +1,671 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitystatisticsmodel.h"
+#include <QDateTime>
+#include <QStringBuilder>
+#include "recordscontroller.h"
+#include "record.h"
+#include "activity.h"
+#include "category.h"
+#include "registry.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+#define ACTIVITYSTATISTICS_METRIC_COUNT 5
+
+using namespace Gibrievida;
+
+QHash<QString, ActivityStatistics> ActivityStatisticsModel::s_cache;
+QPointer<RecordsController> ActivityStatisticsModel::s_cacheController;
+QList<QMetaObject::Connection> ActivityStatisticsModel::s_cacheConnections;
+
+/*!
+ * \brief Returns \c value as double, or an invalid variant if it is \c NULL.
+ */
+static QVariant statisticsValue(const QVariant &value)
+{
+    return value.isNull() ? QVariant() : QVariant::fromValue(value.toDouble());
+}
+
+
+/*!
+ * \brief Constructs a new empty statistics model.
+ */
+ActivityStatisticsModel::ActivityStatisticsModel(QObject *parent) : DBModel(parent)
+{
+    m_recsController = nullptr;
+    m_activityId = 0;
+    m_categoryId = 0;
+    m_window = AllTime;
+}
+
+
+/*!
+ * \brief Destroys the model.
+ */
+ActivityStatisticsModel::~ActivityStatisticsModel()
+{
+
+}
+
+
+/*!
+ * \brief Reimplemented from QAbstractItemModel.
+ */
+QHash<int, QByteArray> ActivityStatisticsModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+    roles.insert(MetricRole, QByteArrayLiteral("metric"));
+    roles.insert(Total, QByteArrayLiteral("total"));
+    roles.insert(Average, QByteArrayLiteral("average"));
+    roles.insert(Best, QByteArrayLiteral("best"));
+    return roles;
+}
+
+
+
+/*!
+ * \brief Reimplemented from QAbstractItemModel.
+ */
+int ActivityStatisticsModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_statistics.totals.size();
+}
+
+
+
+/*!
+ * \brief Reimplemented from QAbstractListModel.
+ */
+QModelIndex ActivityStatisticsModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column);
+}
+
+
+
+/*!
+ * \brief Reimplemented from QAbstractItemModel.
+ */
+QVariant ActivityStatisticsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const int row = index.row();
+
+    if (row > (rowCount()-1)) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case MetricRole:
+        return QVariant::fromValue(row);
+    case Total:
+        return m_statistics.totals.at(row);
+    case Average:
+        return m_statistics.averages.at(row);
+    case Best:
+        return m_statistics.bests.at(row);
+    default:
+        return QVariant();
+    }
+}
+
+
+
+/*!
+ * \brief Returns the query that calculates the statistics.
+ *
+ * If \a activityId is valid, the query takes the activity ID twice as bind values, otherwise if
+ * \a categoryId is valid, it takes the category ID twice. If \a windowed is true, the start time
+ * of the window is the last bind value.
+ */
+QString ActivityStatisticsModel::statisticsQuery(int activityId, int categoryId, bool windowed)
+{
+    QString queryString = QStringLiteral("SELECT COUNT(*), "
+                                         "SUM(duration), AVG(duration), MAX(duration), "
+                                         "SUM(repetitions), AVG(NULLIF(repetitions, 0)), MAX(NULLIF(repetitions, 0)), "
+                                         "SUM(distance), AVG(NULLIF(distance, 0.0)), MAX(NULLIF(distance, 0.0)), "
+                                         "NULL, AVG(NULLIF(tpr, 0.0)), MIN(NULLIF(tpr, 0.0)), "
+                                         "NULL, AVG(NULLIF(avgSpeed, 0.0)), MAX(NULLIF(maxSpeed, 0.0)), ");
+
+    if (activityId > 0) {
+        queryString.append(QLatin1String("(SELECT category FROM activities WHERE id = ?) FROM records WHERE end > 0 AND activity = ?"));
+    } else if (categoryId > 0) {
+        queryString.append(QLatin1String("? FROM records WHERE end > 0 AND activity IN (SELECT id FROM activities WHERE category = ?)"));
+    } else {
+        queryString.append(QLatin1String("0 FROM records WHERE end > 0"));
+    }
+
+    if (windowed) {
+        queryString.append(QLatin1String(" AND start >= ?"));
+    }
+
+    return queryString;
+}
+
+
+
+/*!
+ * \brief Loads the statistics for the current activity, category and window.
+ *
+ * Cached statistics are used directly, otherwise they are calculated on the DBWorker thread.
+ */
+void ActivityStatisticsModel::update()
+{
+    cancelQuery();
+
+    const QString key = cacheKey();
+
+    if (s_cache.contains(key)) {
+        setStatistics(s_cache.value(key));
+        return;
+    }
+
+    QVariantList bindValues;
+
+    if (m_activityId > 0) {
+        bindValues << m_activityId << m_activityId;
+    } else if (m_categoryId > 0) {
+        bindValues << m_categoryId << m_categoryId;
+    }
+
+    const qint64 start = windowStart();
+
+    if (start > 0) {
+        bindValues << start;
+    }
+
+    m_queryKey = key;
+
+    startQuery(statisticsQuery(m_activityId, m_categoryId, start > 0), bindValues);
+}
+
+
+
+/*!
+ * \brief Stores the calculated statistics in the cache and shows them if they are still requested.
+ */
+void ActivityStatisticsModel::queryFinished(const DBRows &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    const QVariantList &row = rows.first();
+
+    ActivityStatistics statistics;
+    statistics.activityId = m_activityId > 0 ? m_activityId : 0;
+    statistics.categoryId = row.at(16).toInt();
+    statistics.count = row.at(0).toInt();
+
+    for (int i = 0; i < ACTIVITYSTATISTICS_METRIC_COUNT; ++i) {
+        statistics.totals.append(statisticsValue(row.at(1 + i * 3)));
+        statistics.averages.append(statisticsValue(row.at(2 + i * 3)));
+        statistics.bests.append(statisticsValue(row.at(3 + i * 3)));
+    }
+
+    // entries of the same selection for earlier window start days are outdated
+    const QString selection = m_queryKey.left(m_queryKey.lastIndexOf(QLatin1Char('/')) + 1);
+    auto i = s_cache.begin();
+    while (i != s_cache.end()) {
+        if (i.key().startsWith(selection)) {
+            i = s_cache.erase(i);
+        } else {
+            ++i;
+        }
+    }
+
+    s_cache.insert(m_queryKey, statistics);
+
+    if (m_queryKey == cacheKey()) {
+        setStatistics(statistics);
+    }
+}
+
+
+
+/*!
+ * \brief Replaces the model data with \a statistics.
+ */
+void ActivityStatisticsModel::setStatistics(const ActivityStatistics &statistics)
+{
+    if (rowCount() != statistics.totals.size()) {
+        beginResetModel();
+        m_statistics = statistics;
+        endResetModel();
+    } else {
+        m_statistics = statistics;
+        if (rowCount() > 0) {
+            emit dataChanged(index(0), index(rowCount()-1), {Total, Average, Best});
+        }
+    }
+
+    emit countChanged(count());
+}
+
+
+
+/*!
+ * \brief Returns the start time of the current window in seconds since the epoch.
+ *
+ * Windows start at local midnight of the first day, so the statistics of a window stay valid for the
+ * rest of the day. Returns \c 0 for AllTime.
+ */
+qint64 ActivityStatisticsModel::windowStart() const
+{
+    int days = 0;
+
+    switch (m_window) {
+    case LastWeek:
+        days = 7;
+        break;
+    case LastMonth:
+        days = 30;
+        break;
+    case LastYear:
+        days = 365;
+        break;
+    default:
+        return 0;
+    }
+
+    return static_cast<qint64>(QDateTime(QDate::currentDate().addDays(-days)).toTime_t());
+}
+
+
+
+/*!
+ * \brief Returns the cache key of the current activity, category and window.
+ *
+ * The key contains the start of the window, so windowed entries of previous days are not used.
+ */
+QString ActivityStatisticsModel::cacheKey() const
+{
+    const QString window = QString::number(m_window) % QLatin1Char('/') % QString::number(windowStart());
+
+    if (m_activityId > 0) {
+        return QLatin1String("a") % QString::number(m_activityId) % QLatin1Char('/') % window;
+    } else if (m_categoryId > 0) {
+        return QLatin1String("c") % QString::number(m_categoryId) % QLatin1Char('/') % window;
+    } else {
+        return QLatin1String("all/") % window;
+    }
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if they have been loaded and their cache entry has been invalidated.
+ */
+void ActivityStatisticsModel::reloadIfInvalidated()
+{
+    if ((rowCount() > 0 || isQueryRunning()) && !s_cache.contains(cacheKey())) {
+        update();
+    }
+}
+
+
+
+/*!
+ * \brief Invalidates the cache entries of \a activity, of its \a category and of all records.
+ */
+void ActivityStatisticsModel::invalidate(int activity, int category)
+{
+    auto i = s_cache.begin();
+    while (i != s_cache.end()) {
+        const ActivityStatistics &s = i.value();
+        if ((s.activityId > 0 && s.activityId == activity) || (s.activityId == 0 && (s.categoryId == category || s.categoryId == 0))) {
+            i = s_cache.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+
+/*!
+ * \brief Invalidates the cache entries of \a category, of all its activities and of all records.
+ */
+void ActivityStatisticsModel::invalidateCategory(int category)
+{
+    auto i = s_cache.begin();
+    while (i != s_cache.end()) {
+        const ActivityStatistics &s = i.value();
+        if (s.categoryId == category || (s.activityId == 0 && s.categoryId == 0)) {
+            i = s_cache.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+
+/*!
+ * \brief Removes all entries from the cache.
+ */
+void ActivityStatisticsModel::invalidateAll()
+{
+    s_cache.clear();
+}
+
+
+
+/*!
+ * \brief Keeps the cache up to date with the changes made through \a controller, even if no model exists.
+ */
+void ActivityStatisticsModel::connectCache(RecordsController *controller)
+{
+    if (!controller || s_cacheController == controller) {
+        return;
+    }
+
+    for (const QMetaObject::Connection &c : s_cacheConnections) {
+        disconnect(c);
+    }
+    s_cacheConnections.clear();
+
+    s_cacheController = controller;
+    invalidateAll();
+
+    // the registry lives as long as the application, so it is used as context object
+    QObject *context = Registry::instance();
+    s_cacheConnections << connect(controller, &RecordsController::finished, context, [] (Record *r) {
+        invalidate(r->activity()->databaseId(), r->activity()->category()->databaseId());
+    });
+    s_cacheConnections << connect(controller, &RecordsController::updated, context, [] (Record *r, int oldActivityId) {
+        invalidate(r->activity()->databaseId(), r->activity()->category()->databaseId());
+        Activity *old = Registry::instance()->activity(oldActivityId);
+        if (old) {
+            invalidate(oldActivityId, old->category()->databaseId());
+        } else {
+            invalidateAll();
+        }
+    });
+    s_cacheConnections << connect(controller, &RecordsController::removed, context, [] (int databaseId, int activity, int category) {
+        Q_UNUSED(databaseId)
+        invalidate(activity, category);
+    });
+    s_cacheConnections << connect(controller, &RecordsController::removedByActivity, context, [] (int activity, int category) {
+        invalidate(activity, category);
+    });
+    s_cacheConnections << connect(controller, &RecordsController::removedByCategory, context, [] (int category) {
+        invalidateCategory(category);
+    });
+    s_cacheConnections << connect(controller, &RecordsController::removedAll, context, [] () {
+        invalidateAll();
+    });
+    s_cacheConnections << connect(Registry::instance(), &Registry::reloaded, context, [] () {
+        invalidateAll();
+    });
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if the finished or updated \a record affects them.
+ */
+void ActivityStatisticsModel::recordChanged(Record *record)
+{
+    Q_UNUSED(record)
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if the updated \a record affects them.
+ */
+void ActivityStatisticsModel::recordUpdated(Record *record, int oldActivityId)
+{
+    Q_UNUSED(record)
+    Q_UNUSED(oldActivityId)
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if the removed record affects them.
+ */
+void ActivityStatisticsModel::recordRemoved(int databaseId, int activity, int category)
+{
+    Q_UNUSED(databaseId)
+    Q_UNUSED(activity)
+    Q_UNUSED(category)
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if the removed records affect them.
+ */
+void ActivityStatisticsModel::recordsRemovedByActivity(int activity, int category)
+{
+    Q_UNUSED(activity)
+    Q_UNUSED(category)
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \brief Reloads the statistics if the removed records affect them.
+ */
+void ActivityStatisticsModel::recordsRemovedByCategory(int category)
+{
+    Q_UNUSED(category)
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \brief Reloads the statistics after all records have been removed.
+ */
+void ActivityStatisticsModel::recordsRemovedAll()
+{
+    reloadIfInvalidated();
+}
+
+
+
+/*!
+ * \property ActivityStatisticsModel::recordsController
+ * \brief Sets the records controller object.
+ *
+ * The signals of the controller invalidate the cached statistics of the affected activities and categories.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>RecordsController*</TD><TD>getRecordsController() const</TD></TR><TR><TD>void</TD><TD>setRecordsController(RecordsController *recordsController)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::recordsController recordsController \endlink property.
+ */
+RecordsController *ActivityStatisticsModel::getRecordsController() const { return m_recsController; }
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::recordsController recordsController \endlink property.
+ */
+void ActivityStatisticsModel::setRecordsController(RecordsController *controller)
+{
+    if (m_recsController) {
+        disconnect(m_recsController, nullptr, this, nullptr);
+        disconnect(Registry::instance(), &Registry::reloaded, this, &ActivityStatisticsModel::recordsRemovedAll);
+    }
+
+    m_recsController = controller;
+#ifdef QT_DEBUG
+    qDebug() << " Set recordsController to" << m_recsController;
+#endif
+
+    if (m_recsController) {
+        connectCache(m_recsController);
+        // the cache connections are made first, so the entries are already invalidated when these slots run
+        connect(m_recsController, &RecordsController::finished, this, &ActivityStatisticsModel::recordChanged);
+        connect(m_recsController, &RecordsController::updated, this, &ActivityStatisticsModel::recordUpdated);
+        connect(m_recsController, &RecordsController::removed, this, &ActivityStatisticsModel::recordRemoved);
+        connect(m_recsController, &RecordsController::removedByActivity, this, &ActivityStatisticsModel::recordsRemovedByActivity);
+        connect(m_recsController, &RecordsController::removedByCategory, this, &ActivityStatisticsModel::recordsRemovedByCategory);
+        connect(m_recsController, &RecordsController::removedAll, this, &ActivityStatisticsModel::recordsRemovedAll);
+        connect(Registry::instance(), &Registry::reloaded, this, &ActivityStatisticsModel::recordsRemovedAll);
+    }
+}
+
+
+
+/*!
+ * \property ActivityStatisticsModel::activityId
+ * \brief Database ID of the activity to calculate the statistics for.
+ *
+ * Takes precedence over the \link ActivityStatisticsModel::categoryId categoryId \endlink. Changing
+ * the activity reloads the statistics if they have been loaded before.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>getActivityId() const</TD></TR><TR><TD>void</TD><TD>setActivityId(int activityId)</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>activityIdChanged(int activityId)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::activityId activityId \endlink property.
+ */
+int ActivityStatisticsModel::getActivityId() const { return m_activityId; }
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::activityId activityId \endlink property.
+ */
+void ActivityStatisticsModel::setActivityId(int activityId)
+{
+    if (m_activityId != activityId) {
+        m_activityId = activityId;
+#ifdef QT_DEBUG
+        qDebug() << " Set activityId to" << m_activityId;
+#endif
+        emit activityIdChanged(getActivityId());
+
+        if (rowCount() > 0 || isQueryRunning()) {
+            update();
+        }
+    }
+}
+
+
+
+/*!
+ * \property ActivityStatisticsModel::categoryId
+ * \brief Database ID of the category to calculate the statistics for.
+ *
+ * Changing the category reloads the statistics if they have been loaded before.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>getCategoryId() const</TD></TR><TR><TD>void</TD><TD>setCategoryId(int categoryId)</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>categoryIdChanged(int categoryId)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::categoryId categoryId \endlink property.
+ */
+int ActivityStatisticsModel::getCategoryId() const { return m_categoryId; }
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::categoryId categoryId \endlink property.
+ */
+void ActivityStatisticsModel::setCategoryId(int categoryId)
+{
+    if (m_categoryId != categoryId) {
+        m_categoryId = categoryId;
+#ifdef QT_DEBUG
+        qDebug() << " Set categoryId to" << m_categoryId;
+#endif
+        emit categoryIdChanged(getCategoryId());
+
+        if (rowCount() > 0 || isQueryRunning()) {
+            update();
+        }
+    }
+}
+
+
+
+/*!
+ * \property ActivityStatisticsModel::window
+ * \brief The time window of the records the statistics are calculated from.
+ *
+ * Changing the window reloads the statistics if they have been loaded before. Default is AllTime.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>Window</TD><TD>getWindow() const</TD></TR><TR><TD>void</TD><TD>setWindow(Window window)</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>windowChanged(Window window)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::window window \endlink property.
+ */
+ActivityStatisticsModel::Window ActivityStatisticsModel::getWindow() const { return m_window; }
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::window window \endlink property.
+ */
+void ActivityStatisticsModel::setWindow(Window window)
+{
+    if (m_window != window) {
+        m_window = window;
+#ifdef QT_DEBUG
+        qDebug() << " Set window to" << m_window;
+#endif
+        emit windowChanged(getWindow());
+
+        if (rowCount() > 0 || isQueryRunning()) {
+            update();
+        }
+    }
+}
+
+
+
+/*!
+ * \property ActivityStatisticsModel::count
+ * \brief Number of finished records the statistics are calculated from.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>count() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>countChanged(int count)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link ActivityStatisticsModel::count count \endlink property.
+ */
+int ActivityStatisticsModel::count() const { return m_statistics.count; }
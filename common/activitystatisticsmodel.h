@@ -0,0 +1,175 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ACTIVITYSTATISTICSMODEL_H
+#define ACTIVITYSTATISTICSMODEL_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QVariant>
+#include <QPointer>
+#include <QList>
+#include "dbmodel.h"
+
+namespace Gibrievida {
+
+class RecordsController;
+class Record;
+
+/*!
+ * \brief Contains the statistics of the finished records of an activity, a category or of all records.
+ */
+struct ActivityStatistics {
+    int activityId = 0; /**< Database ID of the activity, \c 0 for category and overall statistics. */
+    int categoryId = 0; /**< Database ID of the category of the activity or of the category. */
+    int count = 0; /**< Number of finished records in the time window. */
+    QVector<QVariant> totals; /**< Total value per metric, invalid if there is none. */
+    QVector<QVariant> averages; /**< Average value per metric, invalid if there is none. */
+    QVector<QVariant> bests; /**< Best value per metric, invalid if there is none. */
+};
+
+
+/*!
+ * \brief Model containing total, average and best values of the records of an activity or category.
+ *
+ * Set either \link ActivityStatisticsModel::activityId activityId \endlink or \link ActivityStatisticsModel::categoryId categoryId \endlink,
+ * if none of them is set, all records are used. The model contains one row per Metric. The statistics are
+ * calculated on the DBWorker thread over the records in the selected \link ActivityStatisticsModel::window window \endlink
+ * and are stored in a cache that is shared by all models. Cache entries are only invalidated by the signals of the
+ * RecordsController that affect their activity or category, so the statistics of unchanged activities are available
+ * immediately.
+ *
+ * The values of durations are in seconds, of distances in meters, of the time per repetition in seconds and of
+ * speeds in meters per second. The best time per repetition is the lowest one.
+ */
+class ActivityStatisticsModel : public DBModel
+{
+    Q_OBJECT
+    Q_PROPERTY(Gibrievida::RecordsController *recordsController READ getRecordsController WRITE setRecordsController)
+    Q_PROPERTY(int activityId READ getActivityId WRITE setActivityId NOTIFY activityIdChanged)
+    Q_PROPERTY(int categoryId READ getCategoryId WRITE setCategoryId NOTIFY categoryIdChanged)
+    Q_PROPERTY(Window window READ getWindow WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_ENUMS(Window)
+    Q_ENUMS(Metric)
+public:
+    explicit ActivityStatisticsModel(QObject *parent = nullptr);
+    ~ActivityStatisticsModel();
+
+    /*!
+     * \brief The model roles.
+     *
+     * Use the enumeration name starting lowercase to access the role from QML.
+     */
+    enum Roles {
+        MetricRole = Qt::UserRole + 1,  /*!< The Metric of the row. Use \c metric in QML. */
+        Total,                          /*!< The total value, undefined for the time per repetition and the speed. */
+        Average,                        /*!< The average value of the records that have a value for the metric. */
+        Best                            /*!< The best value of all records. */
+    };
+
+    /*!
+     * \brief The metrics contained in the model rows.
+     */
+    enum Metric {
+        Duration = 0,   /*!< Duration of the records. */
+        Repetitions,    /*!< Repetitions of the records. */
+        Distance,       /*!< Distance of the records. */
+        Tpr,            /*!< Time per repetition of the records. */
+        Speed           /*!< Average and maximum speed of the records. */
+    };
+
+    /*!
+     * \brief The time windows the statistics can be calculated for.
+     */
+    enum Window {
+        AllTime = 0,    /*!< All records. */
+        LastWeek,       /*!< Records started in the last 7 days. */
+        LastMonth,      /*!< Records started in the last 30 days. */
+        LastYear        /*!< Records started in the last 365 days. */
+    };
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE Q_DECL_FINAL;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE Q_DECL_FINAL;
+    QModelIndex index(int row, int column = 0, const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
+
+    void setRecordsController(RecordsController *controller);
+    RecordsController *getRecordsController() const;
+
+    void setActivityId(int activityId);
+    int getActivityId() const;
+
+    void setCategoryId(int categoryId);
+    int getCategoryId() const;
+
+    void setWindow(Window window);
+    Window getWindow() const;
+
+    int count() const;
+
+    static QString statisticsQuery(int activityId, int categoryId, bool windowed);
+
+public slots:
+    void update();
+
+signals:
+    void activityIdChanged(int activityId);
+    void categoryIdChanged(int categoryId);
+    void windowChanged(Gibrievida::ActivityStatisticsModel::Window window);
+    void countChanged(int count);
+
+private slots:
+    void recordChanged(Record *record);
+    void recordUpdated(Record *record, int oldActivityId);
+    void recordRemoved(int databaseId, int activity, int category);
+    void recordsRemovedByActivity(int activity, int category);
+    void recordsRemovedByCategory(int category);
+    void recordsRemovedAll();
+
+private:
+    void queryFinished(const DBRows &rows) Q_DECL_OVERRIDE;
+    void setStatistics(const ActivityStatistics &statistics);
+    qint64 windowStart() const;
+    QString cacheKey() const;
+    void reloadIfInvalidated();
+
+    static void connectCache(RecordsController *controller);
+    static void invalidate(int activity, int category);
+    static void invalidateCategory(int category);
+    static void invalidateAll();
+
+    static QHash<QString, ActivityStatistics> s_cache;
+    static QPointer<RecordsController> s_cacheController;
+    static QList<QMetaObject::Connection> s_cacheConnections;
+
+    RecordsController *m_recsController;
+    int m_activityId;
+    int m_categoryId;
+    Window m_window;
+    ActivityStatistics m_statistics;
+    QString m_queryKey;
+
+    Q_DISABLE_COPY(ActivityStatisticsModel)
+};
+
+}
+
+#endif // ACTIVITYSTATISTICSMODEL_H
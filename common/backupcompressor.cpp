@@ -0,0 +1,145 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "backupcompressor.h"
+#include <QFile>
+#include <QByteArray>
+#include <zlib.h>
+#include "globals.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#include <QElapsedTimer>
+#endif
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Returns true if the backup file at \a path is compressed.
+ */
+bool BackupCompressor::isCompressed(const QString &path)
+{
+    return path.endsWith(QLatin1String(".gz"));
+}
+
+
+/*!
+ * \brief Writes the gzip compressed content of \a source to \a target.
+ *
+ * Returns true on success. On failure, \a target will be removed.
+ */
+bool BackupCompressor::compress(const QString &source, const QString &target)
+{
+#ifdef QT_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    QFile in(source);
+
+    if (!in.open(QIODevice::ReadOnly)) {
+        qWarning("Failed to open %s", qUtf8Printable(source));
+        return false;
+    }
+
+    gzFile out = gzopen(QFile::encodeName(target).constData(), BACKUP_COMPRESSION_LEVEL);
+
+    if (!out) {
+        qWarning("Failed to open %s", qUtf8Printable(target));
+        return false;
+    }
+
+    QByteArray buffer(BACKUP_COMPRESSION_CHUNK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+
+    while (ok && !in.atEnd()) {
+        const qint64 read = in.read(buffer.data(), buffer.size());
+        if (read < 0) {
+            ok = false;
+        } else if (read > 0) {
+            ok = (gzwrite(out, buffer.constData(), static_cast<unsigned int>(read)) == read);
+        }
+    }
+
+    if (gzclose(out) != Z_OK) {
+        ok = false;
+    }
+
+    if (!ok) {
+        qWarning("Failed to compress %s", qUtf8Printable(source));
+        QFile::remove(target);
+        return false;
+    }
+
+#ifdef QT_DEBUG
+    const qint64 rawSize = in.size();
+    const qint64 compressedSize = QFile(target).size();
+    const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug("Compressed %lli bytes to %lli bytes (%.1f %%) in %lli ms, %lli KiB/s",
+           rawSize, compressedSize, rawSize > 0 ? (100.0 * compressedSize / rawSize) : 0.0, elapsed, (rawSize * 1000 / elapsed) / 1024);
+#endif
+
+    return true;
+}
+
+
+/*!
+ * \brief Writes the decompressed content of the gzip file \a source to \a target.
+ *
+ * Returns true on success. On failure, \a target will be removed.
+ */
+bool BackupCompressor::decompress(const QString &source, const QString &target)
+{
+    gzFile in = gzopen(QFile::encodeName(source).constData(), "rb");
+
+    if (!in) {
+        qWarning("Failed to open %s", qUtf8Printable(source));
+        return false;
+    }
+
+    QFile out(target);
+
+    if (!out.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        qWarning("Failed to open %s", qUtf8Printable(target));
+        gzclose(in);
+        return false;
+    }
+
+    QByteArray buffer(BACKUP_COMPRESSION_CHUNK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+    int read = 0;
+
+    while (ok && (read = gzread(in, buffer.data(), static_cast<unsigned int>(buffer.size()))) > 0) {
+        ok = (out.write(buffer.constData(), read) == read);
+    }
+
+    if (read < 0) {
+        ok = false;
+    }
+
+    gzclose(in);
+    out.close();
+
+    if (!ok) {
+        qWarning("Failed to decompress %s", qUtf8Printable(source));
+        QFile::remove(target);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUPCOMPRESSOR_H
+#define BACKUPCOMPRESSOR_H
+
+#include <QString>
+
+namespace Gibrievida {
+
+/*!
+ * \brief Compresses and decompresses backup files in the gzip format.
+ *
+ * The data is streamed in chunks of BACKUP_COMPRESSION_CHUNK_SIZE bytes, so the memory usage
+ * does not depend on the size of the database.
+ */
+class BackupCompressor
+{
+public:
+    static bool compress(const QString &source, const QString &target);
+    static bool decompress(const QString &source, const QString &target);
+    static bool isCompressed(const QString &path);
+
+private:
+    BackupCompressor();
+};
+
+}
+
+#endif // BACKUPCOMPRESSOR_H
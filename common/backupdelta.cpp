@@ -0,0 +1,500 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "backupdelta.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QSet>
+#include <cstdio>
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+#define BACKUPDELTA_MAGIC 0x47424456
+#define BACKUPDELTA_FORMAT_VERSION 1
+#define BACKUPDELTA_HASH_SIZE 16
+#define BACKUPDELTA_MAX_CHAIN_LENGTH 1000
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Returns true if the backup file at \a path is a delta backup.
+ */
+bool BackupDelta::isDelta(const QString &path)
+{
+    return path.endsWith(QLatin1String(".backup.delta"));
+}
+
+
+/*!
+ * \brief Returns the path of the parent backup of the delta backup at \a path.
+ *
+ * Returns an empty string if \a path is not a readable delta backup.
+ */
+QString BackupDelta::parent(const QString &path)
+{
+    QFile f(path);
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    Header header;
+
+    if (!readHeader(&f, header)) {
+        return QString();
+    }
+
+    return QFileInfo(path).absoluteDir().absoluteFilePath(header.parent);
+}
+
+
+/*!
+ * \brief Returns the paths of all backups needed to restore the backup at \a path.
+ *
+ * The first entry is the full base backup, the last one is \a path. Returns an empty list if
+ * the chain is broken.
+ */
+QStringList BackupDelta::chain(const QString &path)
+{
+    QStringList paths({path});
+
+    QString current = path;
+
+    while (isDelta(current)) {
+
+        current = parent(current);
+
+        if (current.isEmpty() || !QFile::exists(current) || paths.size() > BACKUPDELTA_MAX_CHAIN_LENGTH) {
+            return QStringList();
+        }
+
+        paths.prepend(current);
+    }
+
+    return paths;
+}
+
+
+/*!
+ * \brief Returns the paths of all delta backups in the same directory whose parent is the backup at \a path.
+ */
+QStringList BackupDelta::children(const QString &path)
+{
+    const QFileInfo fi(path);
+    const QString absolutePath = fi.absoluteFilePath();
+    const QDir dir = fi.absoluteDir();
+
+    QStringList paths;
+
+    const QStringList deltas = dir.entryList(QStringList(QStringLiteral("*.backup.delta")), QDir::Files);
+    for (const QString &delta : deltas) {
+        const QString deltaPath = dir.absoluteFilePath(delta);
+        if (parent(deltaPath) == absolutePath) {
+            paths.append(deltaPath);
+        }
+    }
+
+    return paths;
+}
+
+
+/*!
+ * \brief Writes a delta backup of the database file \a snapshot relative to \a parentPath to \a target.
+ *
+ * \a parentPath has to be an uncompressed full backup or a delta backup. Returns true on success.
+ */
+bool BackupDelta::create(const QString &snapshot, const QString &parentPath, const QString &target)
+{
+    Header header;
+    header.parent = QFileInfo(parentPath).fileName();
+    header.pageSize = databasePageSize(snapshot);
+
+    if (header.pageSize == 0) {
+        return false;
+    }
+
+    quint32 parentPageSize = 0;
+    QVector<QByteArray> parentHashes;
+
+    if (!pageHashes(parentPath, parentPageSize, parentHashes)) {
+        return false;
+    }
+
+    // a changed page size invalidates all pages of the parent
+    if (parentPageSize != header.pageSize) {
+        parentHashes.clear();
+    }
+
+    QFile in(snapshot);
+
+    if (!in.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    header.pageCount = static_cast<quint32>(in.size() / header.pageSize);
+    header.hashes.reserve(header.pageCount);
+
+    QVector<quint32> changed;
+    QByteArray page(header.pageSize, Qt::Uninitialized);
+
+    for (quint32 i = 0; i < header.pageCount; ++i) {
+        if (in.read(page.data(), header.pageSize) != header.pageSize) {
+            return false;
+        }
+        const QByteArray hash = QCryptographicHash::hash(page, QCryptographicHash::Md5);
+        if (static_cast<int>(i) >= parentHashes.size() || parentHashes.at(i) != hash) {
+            changed.append(i);
+        }
+        header.hashes.append(hash);
+    }
+
+    header.changedCount = static_cast<quint32>(changed.size());
+
+    QFile out(target);
+
+    if (!out.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        return false;
+    }
+
+    if (!writeHeader(&out, header)) {
+        return false;
+    }
+
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    for (quint32 pageNo : changed) {
+        if (!in.seek(static_cast<qint64>(pageNo) * header.pageSize) || in.read(page.data(), header.pageSize) != header.pageSize) {
+            return false;
+        }
+        stream << pageNo;
+        if (stream.writeRawData(page.constData(), header.pageSize) != static_cast<int>(header.pageSize)) {
+            return false;
+        }
+    }
+
+#ifdef QT_DEBUG
+    qDebug("Created delta backup with %u of %u pages.", header.changedCount, header.pageCount);
+#endif
+
+    return (stream.status() == QDataStream::Ok) && out.flush();
+}
+
+
+/*!
+ * \brief Rebuilds the database of the delta backup at \a path into the file \a target.
+ *
+ * Copies the base backup and applies all deltas of the chain. Returns true on success.
+ */
+bool BackupDelta::restore(const QString &path, const QString &target)
+{
+    const QStringList paths = chain(path);
+
+    if (paths.isEmpty()) {
+        qWarning("The backup chain of %s is broken.", qUtf8Printable(path));
+        return false;
+    }
+
+    QFile::remove(target);
+
+    if (!QFile::copy(paths.first(), target)) {
+        return false;
+    }
+
+    QFile out(target);
+
+    if (!out.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    for (int i = 1; i < paths.size(); ++i) {
+
+        QFile in(paths.at(i));
+
+        if (!in.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        Header header;
+
+        if (!readHeader(&in, header)) {
+            return false;
+        }
+
+        QDataStream stream(&in);
+        stream.setVersion(QDataStream::Qt_5_6);
+
+        QByteArray page(header.pageSize, Qt::Uninitialized);
+
+        for (quint32 c = 0; c < header.changedCount; ++c) {
+            quint32 pageNo = 0;
+            stream >> pageNo;
+            if (stream.readRawData(page.data(), header.pageSize) != static_cast<int>(header.pageSize)) {
+                return false;
+            }
+            if (!out.seek(static_cast<qint64>(pageNo) * header.pageSize) || out.write(page) != page.size()) {
+                return false;
+            }
+        }
+
+        if (!out.resize(static_cast<qint64>(header.pageCount) * header.pageSize)) {
+            return false;
+        }
+    }
+
+    return out.flush();
+}
+
+
+/*!
+ * \brief Merges the delta backup \a older into its child delta backup \a newer.
+ *
+ * The merged delta replaces \a newer and gets the parent of \a older. Afterwards \a older
+ * will be removed, unless another delta backup is still based on it. Returns true on success.
+ */
+bool BackupDelta::merge(const QString &older, const QString &newer)
+{
+    QFile oldFile(older);
+    QFile newFile(newer);
+
+    if (!oldFile.open(QIODevice::ReadOnly) || !newFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    Header oldHeader;
+    Header newHeader;
+
+    if (!readHeader(&oldFile, oldHeader) || !readHeader(&newFile, newHeader)) {
+        return false;
+    }
+
+    if (newHeader.parent != QFileInfo(older).fileName() || oldHeader.pageSize != newHeader.pageSize) {
+        return false;
+    }
+
+    const quint32 pageSize = newHeader.pageSize;
+    const qint64 entrySize = static_cast<qint64>(sizeof(quint32)) + pageSize;
+
+    QDataStream oldStream(&oldFile);
+    oldStream.setVersion(QDataStream::Qt_5_6);
+    QDataStream newStream(&newFile);
+    newStream.setVersion(QDataStream::Qt_5_6);
+
+    // pages of the newer delta replace the same pages of the older one
+    QSet<quint32> newPages;
+    newPages.reserve(newHeader.changedCount);
+    for (quint32 c = 0; c < newHeader.changedCount; ++c) {
+        quint32 pageNo = 0;
+        newFile.seek(newHeader.dataOffset + c * entrySize);
+        newStream >> pageNo;
+        newPages.insert(pageNo);
+    }
+
+    QVector<quint32> oldEntries;
+    for (quint32 c = 0; c < oldHeader.changedCount; ++c) {
+        quint32 pageNo = 0;
+        oldFile.seek(oldHeader.dataOffset + c * entrySize);
+        oldStream >> pageNo;
+        if (pageNo < newHeader.pageCount && !newPages.contains(pageNo)) {
+            oldEntries.append(c);
+        }
+    }
+
+    Header merged = newHeader;
+    merged.parent = oldHeader.parent;
+    merged.changedCount = newHeader.changedCount + static_cast<quint32>(oldEntries.size());
+
+    const QString tmpPath = newer + QLatin1String(".tmp");
+    QFile out(tmpPath);
+
+    if (!out.open(QIODevice::WriteOnly|QIODevice::Truncate) || !writeHeader(&out, merged)) {
+        QFile::remove(tmpPath);
+        return false;
+    }
+
+    QByteArray entry(static_cast<int>(entrySize), Qt::Uninitialized);
+    bool ok = true;
+
+    for (quint32 c : oldEntries) {
+        ok = ok && oldFile.seek(oldHeader.dataOffset + c * entrySize) && (oldFile.read(entry.data(), entrySize) == entrySize) && (out.write(entry) == entrySize);
+    }
+
+    newFile.seek(newHeader.dataOffset);
+    for (quint32 c = 0; ok && c < newHeader.changedCount; ++c) {
+        ok = (newFile.read(entry.data(), entrySize) == entrySize) && (out.write(entry) == entrySize);
+    }
+
+    ok = ok && out.flush();
+    out.close();
+    oldFile.close();
+    newFile.close();
+
+    if (!ok || std::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(newer).constData()) != 0) {
+        QFile::remove(tmpPath);
+        return false;
+    }
+
+#ifdef QT_DEBUG
+    qDebug("Merged delta backup %s into %s.", qUtf8Printable(older), qUtf8Printable(newer));
+#endif
+
+    // other chains that branch off at the older delta still need it to be restored
+    if (children(older).isEmpty()) {
+        QFile::remove(older);
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Reads the \a header of the delta backup from \a device.
+ *
+ * Afterwards, the device is positioned at the first stored page.
+ */
+bool BackupDelta::readHeader(QIODevice *device, Header &header)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+
+    stream >> magic >> version;
+
+    if (magic != BACKUPDELTA_MAGIC || version != BACKUPDELTA_FORMAT_VERSION) {
+        return false;
+    }
+
+    stream >> header.parent >> header.pageSize >> header.pageCount >> header.changedCount;
+
+    if (stream.status() != QDataStream::Ok || header.pageSize == 0) {
+        return false;
+    }
+
+    header.hashes.clear();
+    header.hashes.reserve(header.pageCount);
+
+    for (quint32 i = 0; i < header.pageCount; ++i) {
+        QByteArray hash(BACKUPDELTA_HASH_SIZE, Qt::Uninitialized);
+        if (stream.readRawData(hash.data(), BACKUPDELTA_HASH_SIZE) != BACKUPDELTA_HASH_SIZE) {
+            return false;
+        }
+        header.hashes.append(hash);
+    }
+
+    header.dataOffset = device->pos();
+
+    return true;
+}
+
+
+/*!
+ * \brief Writes the \a header of a delta backup to \a device.
+ */
+bool BackupDelta::writeHeader(QIODevice *device, const Header &header)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    stream << static_cast<quint32>(BACKUPDELTA_MAGIC) << static_cast<quint32>(BACKUPDELTA_FORMAT_VERSION);
+    stream << header.parent << header.pageSize << header.pageCount << header.changedCount;
+
+    for (const QByteArray &hash : header.hashes) {
+        stream.writeRawData(hash.constData(), BACKUPDELTA_HASH_SIZE);
+    }
+
+    return (stream.status() == QDataStream::Ok);
+}
+
+
+/*!
+ * \brief Returns the \a pageSize and the page \a hashes of the backup at \a path.
+ *
+ * Delta backups contain the hashes, for full backups they are calculated from the file.
+ */
+bool BackupDelta::pageHashes(const QString &path, quint32 &pageSize, QVector<QByteArray> &hashes)
+{
+    QFile f(path);
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    if (isDelta(path)) {
+        Header header;
+        if (!readHeader(&f, header)) {
+            return false;
+        }
+        pageSize = header.pageSize;
+        hashes = header.hashes;
+        return true;
+    }
+
+    f.close();
+
+    pageSize = databasePageSize(path);
+
+    if (pageSize == 0 || !f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const quint32 pageCount = static_cast<quint32>(f.size() / pageSize);
+    hashes.clear();
+    hashes.reserve(pageCount);
+
+    QByteArray page(pageSize, Qt::Uninitialized);
+
+    for (quint32 i = 0; i < pageCount; ++i) {
+        if (f.read(page.data(), pageSize) != pageSize) {
+            return false;
+        }
+        hashes.append(QCryptographicHash::hash(page, QCryptographicHash::Md5));
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Returns the page size of the SQLite database file at \a path, or \c 0 on error.
+ */
+quint32 BackupDelta::databasePageSize(const QString &path)
+{
+    QFile f(path);
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    const QByteArray header = f.read(100);
+
+    if (header.size() < 100 || !header.startsWith("SQLite format 3")) {
+        return 0;
+    }
+
+    // big-endian value at offset 16, 1 means 65536
+    const quint32 size = (static_cast<quint8>(header.at(16)) << 8) | static_cast<quint8>(header.at(17));
+
+    return (size == 1) ? 65536 : size;
+}
@@ -0,0 +1,79 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUPDELTA_H
+#define BACKUPDELTA_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+
+class QIODevice;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Creates, restores and merges incremental page delta backups.
+ *
+ * A delta backup contains only the database pages that have been changed since its parent backup,
+ * which is either a full uncompressed backup or another delta backup in the same directory. Together
+ * with the pages, a delta stores a hash of every page of the database, so the next delta can be
+ * created without rebuilding the previous state.
+ *
+ * Delta backups are named \c YYYYMMDDHHMMSS.backup.delta. Restoring a delta replays the chain from
+ * the full base backup over all deltas up to the requested one. merge() compacts two consecutive
+ * deltas into one, the older delta is only removed if no other delta is based on it.
+ */
+class BackupDelta
+{
+public:
+    static bool isDelta(const QString &path);
+    static QString parent(const QString &path);
+    static QStringList chain(const QString &path);
+    static QStringList children(const QString &path);
+
+    static bool create(const QString &snapshot, const QString &parentPath, const QString &target);
+    static bool restore(const QString &path, const QString &target);
+    static bool merge(const QString &older, const QString &newer);
+
+private:
+    BackupDelta();
+
+    /*!
+     * \brief Header data of a delta backup file.
+     */
+    struct Header {
+        QString parent;         /*!< File name of the parent backup. */
+        quint32 pageSize;       /*!< Page size of the database. */
+        quint32 pageCount;      /*!< Number of pages of the database. */
+        quint32 changedCount;   /*!< Number of stored pages. */
+        QVector<QByteArray> hashes; /*!< Hashes of all pages of the database. */
+        qint64 dataOffset;      /*!< Offset of the first stored page in the file. */
+    };
+
+    static bool readHeader(QIODevice *device, Header &header);
+    static bool writeHeader(QIODevice *device, const Header &header);
+    static bool pageHashes(const QString &path, quint32 &pageSize, QVector<QByteArray> &hashes);
+    static quint32 databasePageSize(const QString &path);
+};
+
+}
+
+#endif // BACKUPDELTA_H
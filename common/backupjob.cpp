@@ -0,0 +1,234 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "backupjob.h"
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QVariant>
+#include <sqlite3.h>
+#include "globals.h"
+#include "connectionpool.h"
+#include "backupcompressor.h"
+#include "backupdelta.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Constructs a new backup job that will write the backup to \a targetPath.
+ */
+BackupJob::BackupJob(const QString &targetPath, QObject *parent) :
+    BackupJob(targetPath, QString(), parent)
+{
+
+}
+
+
+/*!
+ * \brief Constructs a new backup job that will write a delta backup against \a parentPath to \a targetPath.
+ *
+ * If \a parentPath is empty, a full backup is created.
+ */
+BackupJob::BackupJob(const QString &targetPath, const QString &parentPath, QObject *parent) :
+    QThread(parent), m_targetPath(targetPath), m_parentPath(parentPath)
+{
+
+}
+
+
+/*!
+ * \brief Destroys the backup job.
+ */
+BackupJob::~BackupJob()
+{
+
+}
+
+
+/*!
+ * \brief Returns the path of the backup file.
+ */
+QString BackupJob::targetPath() const
+{
+    return m_targetPath;
+}
+
+
+/*!
+ * \brief The starting point for the thread.
+ */
+void BackupJob::run()
+{
+    emit done(backup());
+}
+
+
+/*!
+ * \brief Copies the database to the target path.
+ *
+ * If the target path ends with \c .gz, the copy will be compressed with the BackupCompressor.
+ *
+ * Returns true on success. On failure, the partially written file will be removed.
+ */
+bool BackupJob::backup()
+{
+    QSqlDatabase db = ConnectionPool::database();
+
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    const QVariant handle = db.driver()->handle();
+
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        qWarning("Failed to get the SQLite database handle.");
+        return false;
+    }
+
+    sqlite3 *source = *static_cast<sqlite3 * const *>(handle.constData());
+
+    if (!source) {
+        return false;
+    }
+
+    QString partPath = m_targetPath + QLatin1String(".part");
+    QFile::remove(partPath);
+
+    sqlite3 *target = nullptr;
+
+    if (sqlite3_open(QFile::encodeName(partPath).constData(), &target) != SQLITE_OK) {
+        qWarning("Failed to open backup file: %s", sqlite3_errmsg(target));
+        sqlite3_close(target);
+        return false;
+    }
+
+    // all steps read from the same snapshot, so changes made in the meantime do not restart the backup
+    if (!db.transaction()) {
+        sqlite3_close(target);
+        QFile::remove(partPath);
+        return false;
+    }
+
+    {
+        QSqlQuery q(db);
+        q.exec(QStringLiteral("SELECT COUNT(*) FROM sqlite_master"));
+    }
+
+    sqlite3_backup *b = sqlite3_backup_init(target, "main", source, "main");
+
+    int rc = SQLITE_ERROR;
+
+    if (b) {
+        do {
+            rc = sqlite3_backup_step(b, BACKUP_PAGES_PER_STEP);
+
+            const int total = sqlite3_backup_pagecount(b);
+            emit progress(total - sqlite3_backup_remaining(b), total);
+
+            if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                sqlite3_sleep(BACKUP_BUSY_DELAY);
+            }
+        } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+        sqlite3_backup_finish(b);
+    }
+
+    if (rc != SQLITE_DONE) {
+        qWarning("Failed to create backup: %s", sqlite3_errmsg(target));
+    }
+
+    db.commit();
+
+    sqlite3_close(target);
+
+    if (rc != SQLITE_DONE) {
+        QFile::remove(partPath);
+        return false;
+    }
+
+    if (!m_parentPath.isEmpty()) {
+
+        const QString deltaPath = m_targetPath + QLatin1String(".tmp");
+        const bool created = BackupDelta::create(partPath, m_parentPath, deltaPath);
+
+        QFile::remove(partPath);
+
+        if (!created) {
+            QFile::remove(deltaPath);
+            return false;
+        }
+
+        partPath = deltaPath;
+
+    } else if (BackupCompressor::isCompressed(m_targetPath)) {
+
+        const QString compressedPath = m_targetPath + QLatin1String(".tmp");
+        const bool compressed = BackupCompressor::compress(partPath, compressedPath);
+
+        QFile::remove(partPath);
+
+        if (!compressed) {
+            return false;
+        }
+
+        partPath = compressedPath;
+    }
+
+    QFile::remove(m_targetPath);
+
+    if (!QFile::rename(partPath, m_targetPath)) {
+        QFile::remove(partPath);
+        return false;
+    }
+
+#ifdef QT_DEBUG
+    qDebug("Created backup %s", qUtf8Printable(m_targetPath));
+#endif
+
+    if (!m_parentPath.isEmpty()) {
+        compact();
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Merges the oldest deltas of the chain of the new backup until it has at most BACKUP_MAX_DELTAS deltas.
+ *
+ * A merged delta that another backup is still based on is kept, see BackupDelta::merge().
+ */
+void BackupJob::compact()
+{
+    QStringList chain = BackupDelta::chain(m_targetPath);
+
+    // the first entry is the full base backup
+    while (chain.size() - 1 > BACKUP_MAX_DELTAS) {
+        if (!BackupDelta::merge(chain.at(1), chain.at(2))) {
+            qWarning("Failed to merge delta backup %s.", qUtf8Printable(chain.at(1)));
+            return;
+        }
+        chain.removeAt(1);
+    }
+}
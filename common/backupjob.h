@@ -0,0 +1,74 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUPJOB_H
+#define BACKUPJOB_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+
+namespace Gibrievida {
+
+/*!
+ * \brief Creates a database backup on its own thread.
+ *
+ * The backup is created with the SQLite online backup API from the connection of the job thread,
+ * while the rest of the application keeps reading and writing the database. The pages are copied
+ * in steps of BACKUP_PAGES_PER_STEP inside a single read transaction, so the backup contains a
+ * consistent snapshot of the database, even while a record is written. The data is written to a
+ * temporary file that is renamed to the target path when the backup is complete. Target paths
+ * ending with \c .gz get a gzip compressed backup.
+ */
+class BackupJob : public QThread
+{
+    Q_OBJECT
+public:
+    explicit BackupJob(const QString &targetPath, QObject *parent = nullptr);
+    BackupJob(const QString &targetPath, const QString &parentPath, QObject *parent = nullptr);
+    ~BackupJob();
+
+    QString targetPath() const;
+
+signals:
+    /*!
+     * \brief This signal is emitted after every backup step with the number of \a copied and \a total pages.
+     */
+    void progress(int copied, int total);
+    /*!
+     * \brief This signal is emitted when the backup has been finished, \a success is false if it failed.
+     */
+    void done(bool success);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    bool backup();
+    void compact();
+
+    QString m_targetPath;
+    QString m_parentPath;
+
+    Q_DISABLE_COPY(BackupJob)
+};
+
+}
+
+#endif // BACKUPJOB_H
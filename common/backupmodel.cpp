@@ -19,13 +19,21 @@
 
 #include "backupmodel.h"
 #include "globals.h"
+#include "connectionpool.h"
+#include "backupjob.h"
+#include "backupcompressor.h"
+#include "backupdelta.h"
+#include "backupscanner.h"
+#include "restorejob.h"
+#include "dbmanager.h"
+#include "dbworker.h"
+#include "registry.h"
 #ifdef QT_DEBUG
 #include <QDebug>
 #endif
 
 #include <QDir>
 #include <QFile>
-#include <QSqlDatabase>
 #include <QStandardPaths>
 #include <QStringList>
 #include <QFileInfoList>
@@ -47,6 +55,7 @@ BackupModel::BackupModel(QObject *parent) : QAbstractListModel(parent)
 #endif
 
     m_inOperation = false;
+    m_progress = 0.0f;
 
     const QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
 
@@ -68,6 +77,10 @@ BackupModel::~BackupModel()
     qDebug() << "Destroying" << this;
 #endif
 
+    if (m_scanner) {
+        m_scanner->requestInterruption();
+    }
+
     qDeleteAll(m_backups);
     m_backups.clear();
 }
@@ -83,6 +96,15 @@ QHash<int, QByteArray> BackupModel::roleNames() const
     roles.insert(Time, QByteArrayLiteral("time"));
     roles.insert(Path, QByteArrayLiteral("path"));
     roles.insert(Size, QByteArrayLiteral("size"));
+    roles.insert(Compressed, QByteArrayLiteral("compressed"));
+    roles.insert(Incremental, QByteArrayLiteral("incremental"));
+    roles.insert(HasMetadata, QByteArrayLiteral("hasMetadata"));
+    roles.insert(Valid, QByteArrayLiteral("valid"));
+    roles.insert(SchemaVersion, QByteArrayLiteral("schemaVersion"));
+    roles.insert(Records, QByteArrayLiteral("records"));
+    roles.insert(Activities, QByteArrayLiteral("activities"));
+    roles.insert(FirstRecord, QByteArrayLiteral("firstRecord"));
+    roles.insert(LastRecord, QByteArrayLiteral("lastRecord"));
     return roles;
 }
 
@@ -134,6 +156,24 @@ QVariant BackupModel::data(const QModelIndex &index, int role) const
         return QVariant::fromValue(b->path);
     case Size:
         return QVariant::fromValue(b->size);
+    case Compressed:
+        return QVariant::fromValue(b->compressed);
+    case Incremental:
+        return QVariant::fromValue(b->incremental);
+    case HasMetadata:
+        return QVariant::fromValue(b->hasMetadata);
+    case Valid:
+        return QVariant::fromValue(b->valid);
+    case SchemaVersion:
+        return QVariant::fromValue(b->schemaVersion);
+    case Records:
+        return QVariant::fromValue(b->records);
+    case Activities:
+        return QVariant::fromValue(b->activities);
+    case FirstRecord:
+        return QVariant::fromValue(b->firstRecord);
+    case LastRecord:
+        return QVariant::fromValue(b->lastRecord);
     default:
         return QVariant();
     }
@@ -160,79 +200,194 @@ void BackupModel::clear()
 
 
 /*!
- * \brief Initializes the model by reading the content of the database directory.
+ * \brief Initializes the model by scanning the database directory.
+ *
+ * The scan runs on a BackupScanner thread, a still running scan will be abandoned. The model is
+ * \link BackupModel::inOperation inOperation \endlink until the list of backups is available.
  */
 void BackupModel::init()
 {
     setInOperation(true);
 
+    if (m_scanner) {
+        m_scanner->disconnect(this);
+        m_scanner->requestInterruption();
+    }
+
+    // the scanner is not a child of the model, so the thread can finish even if the model is destroyed
+    m_scanner = new BackupScanner(m_dbdir.absolutePath());
+    connect(m_scanner.data(), &QThread::finished, m_scanner.data(), &QObject::deleteLater);
+    connect(m_scanner.data(), &BackupScanner::listed, this, &BackupModel::setBackups);
+    connect(m_scanner.data(), &BackupScanner::updated, this, &BackupModel::updateBackup);
+
+    m_scanner->start(QThread::LowPriority);
+}
+
+
+
+/*!
+ * \brief Replaces the model data with the listed \a backups.
+ */
+void BackupModel::setBackups(const QVector<BackupMetadata> &backups)
+{
     clear();
 
-    QFileInfoList backupFiles = m_dbdir.entryInfoList(QStringList({QStringLiteral("*.backup.sqlite")}), QDir::Files|QDir::Readable|QDir::Writable, QDir::Name|QDir::Reversed);
+    if (!backups.isEmpty()) {
 
-    if (backupFiles.isEmpty()) {
-        setInOperation(false);
-        return;
+        m_backups.reserve(backups.size());
+
+        beginInsertRows(QModelIndex(), 0, backups.size()-1);
+
+        for (const BackupMetadata &m : backups) {
+            Backup *b = new Backup;
+            b->time = QDateTime::fromString(QFileInfo(m.path).baseName(), QStringLiteral("yyyyMMddHHmmss"));
+            b->path = m.path;
+            b->size = m_locale.toString((float)m.size/1024.0f, 'g', 1).append(QLatin1String(" KiB"));
+            b->compressed = BackupCompressor::isCompressed(b->path);
+            b->incremental = BackupDelta::isDelta(b->path);
+            setMetadata(b, m);
+            m_backups.append(b);
+        }
+
+        endInsertRows();
     }
 
-    m_backups.reserve(backupFiles.size());
+    setInOperation(false);
+}
+
 
-    beginInsertRows(QModelIndex(), 0, m_backups.size()-1);
 
-    Q_FOREACH(const QFileInfo &backup, backupFiles) {
-        Backup *b = new Backup;
-        b->time = QDateTime::fromString(backup.baseName(), QStringLiteral("yyyyMMddHHmmss"));
-        b->path = backup.absoluteFilePath();
-        b->size = m_locale.toString((float)backup.size()/1024.0f, 'g', 1).append(QLatin1String(" KiB"));
-        m_backups.append(b);
+/*!
+ * \brief Updates the metadata of the \a backup in the model.
+ */
+void BackupModel::updateBackup(const BackupMetadata &backup)
+{
+    for (int i = 0; i < m_backups.size(); ++i) {
+        if (m_backups.at(i)->path == backup.path) {
+            setMetadata(m_backups.at(i), backup);
+            const QModelIndex idx = index(i);
+            emit dataChanged(idx, idx, {HasMetadata, Valid, SchemaVersion, Records, Activities, FirstRecord, LastRecord});
+            return;
+        }
     }
+}
 
-    endInsertRows();
 
-    setInOperation(false);
+
+/*!
+ * \brief Copies the metadata \a m into the backup \a b.
+ */
+void BackupModel::setMetadata(Backup *b, const BackupMetadata &m) const
+{
+    b->hasMetadata = m.loaded;
+    b->valid = m.valid;
+    b->schemaVersion = m.schemaVersion;
+    b->records = m.records;
+    b->activities = m.activities;
+    b->firstRecord = m.firstRecord;
+    b->lastRecord = m.lastRecord;
 }
 
 
 
 /*!
  * \brief Creates a new backup.
+ *
+ * The backup is created by a BackupJob on its own thread, while the database can still be used.
+ * The model is \link BackupModel::inOperation inOperation \endlink until the backup has been
+ * finished, the \link BackupModel::progress progress \endlink property contains the amount of
+ * copied data. If \a compressed is true, the backup will be stored gzip compressed.
  */
-void BackupModel::create()
+void BackupModel::create(bool compressed)
 {
-    setInOperation(true);
+    if (m_backupJob || m_restoreJob) {
+        return;
+    }
 
-    QSqlDatabase db = QSqlDatabase::database();
-    db.close();
+    const QDateTime time = QDateTime::currentDateTime();
+    const QString path = m_dbdir.absoluteFilePath(time.toString(QStringLiteral("yyyyMMddHHmmss")).append(compressed ? QLatin1String(".backup.sqlite.gz") : QLatin1String(".backup.sqlite")));
 
-    QFile currentDb(db.databaseName());
+    startBackup(path, QString());
+}
 
-    QDateTime time = QDateTime::currentDateTime();
-    QString path = m_dbdir.absoluteFilePath(time.toString(QStringLiteral("yyyyMMddHHmmss")).append(QLatin1String(".backup.sqlite")));
 
-    if (currentDb.copy(path)) {
 
-        QFileInfo fi(path);
+/*!
+ * \brief Creates a new incremental backup.
+ *
+ * The incremental backup only contains the database pages that have been changed since the newest
+ * uncompressed backup. If there is no such backup, a full uncompressed backup will be created instead.
+ * If the chain of the new backup has more than BACKUP_MAX_DELTAS incremental backups, the oldest
+ * ones will be merged.
+ */
+void BackupModel::createIncremental()
+{
+    if (m_backupJob || m_restoreJob) {
+        return;
+    }
 
-        beginInsertRows(QModelIndex(), 0, 0);
+    QString parentPath;
 
-        Backup *b = new Backup;
-        b->time = time;
-        b->path = path;
-        b->size = m_locale.toString((float)fi.size()/1024.0f, 'g', 1).append(QLatin1String(" KiB"));
+    for (const Backup *b : m_backups) {
+        if (!b->compressed) {
+            parentPath = b->path;
+            break;
+        }
+    }
 
-        m_backups.prepend(b);
+    if (parentPath.isEmpty()) {
+        create(false);
+        return;
+    }
 
-        endInsertRows();
+    const QDateTime time = QDateTime::currentDateTime();
+    const QString path = m_dbdir.absoluteFilePath(time.toString(QStringLiteral("yyyyMMddHHmmss")).append(QLatin1String(".backup.delta")));
 
-    }
+    startBackup(path, parentPath);
+}
 
-    setInOperation(false);
+
+
+/*!
+ * \brief Starts a BackupJob that writes the backup to \a path, relative to \a parentPath if not empty.
+ */
+void BackupModel::startBackup(const QString &path, const QString &parentPath)
+{
+    setInOperation(true);
+    setProgress(0.0f);
+
+    // the job is not a child of the model, so the thread can finish even if the model is destroyed
+    m_backupJob = new BackupJob(path, parentPath);
+    connect(m_backupJob.data(), &QThread::finished, m_backupJob.data(), &QObject::deleteLater);
+    connect(m_backupJob.data(), &BackupJob::progress, this, [this] (int copied, int total) {
+        if (total > 0) {
+            setProgress(static_cast<float>(copied) / static_cast<float>(total));
+        }
+    });
+    connect(m_backupJob.data(), &BackupJob::done, this, [this] (bool success) {
+
+        setProgress(1.0f);
+
+        // rescan, as merging old deltas may have removed backup files
+        if (success) {
+            init();
+        } else {
+            setInOperation(false);
+        }
+    });
+
+    m_backupJob->start(QThread::LowPriority);
 }
 
 
 
 /*!
  * \brief Restores the backup identified by \c index.
+ *
+ * A RestoreJob verifies and upgrades a copy of the backup on its own thread. If the copy is usable,
+ * all connections are closed and the copy atomically replaces the database, afterwards the Registry
+ * reloads the data. The current database is kept if the backup is not usable. The restored() signal
+ * is emitted with the result.
  */
 void BackupModel::restore(int index)
 {
@@ -248,25 +403,51 @@ void BackupModel::restore(int index)
         return;
     }
 
+    if (m_backupJob || m_restoreJob) {
+        qWarning("Can not restore a backup while another backup operation is running.");
+        return;
+    }
+
+    if (!DBManager::isReady()) {
+        qWarning("Can not restore a backup before the database is ready.");
+        return;
+    }
+
     setInOperation(true);
 
-    QSqlDatabase db = QSqlDatabase::database();
-    db.close();
+    m_restoreJob = new RestoreJob(m_backups.at(index)->path, ConnectionPool::databasePath());
+    connect(m_restoreJob.data(), &QThread::finished, m_restoreJob.data(), &QObject::deleteLater);
+    connect(m_restoreJob.data(), &RestoreJob::done, this, [this] (bool success) {
 
-    QFile currentDb(db.databaseName());
-    QFile backupDb(m_backups.at(index)->path);
+        const QString tempPath = m_restoreJob ? m_restoreJob->tempPath() : QString();
 
-    if (currentDb.remove()) {
-        backupDb.copy(db.databaseName());
-    }
+        if (success && !tempPath.isEmpty()) {
 
-    setInOperation(false);
+            ConnectionPool::close();
+
+            success = DBWorker::instance()->replaceDatabase(tempPath);
+
+            if (success) {
+                Registry::instance()->reload();
+            } else {
+                QFile::remove(tempPath);
+            }
+        }
+
+        setInOperation(false);
+
+        emit restored(success);
+    });
+
+    m_restoreJob->start(QThread::LowPriority);
 }
 
 
 
 /*!
  * \brief Removes the backup identfied by \c index.
+ *
+ * Incremental backups that depend on the removed backup will be removed, too.
  */
 void BackupModel::remove(int index)
 {
@@ -284,14 +465,36 @@ void BackupModel::remove(int index)
 
     setInOperation(true);
 
-    QFile file(m_backups.at(index)->path);
+    const QString path = m_backups.at(index)->path;
+
+    QStringList dependents;
+
+    for (const Backup *b : m_backups) {
+        if (b->incremental && b->path != path && BackupDelta::chain(b->path).contains(path)) {
+            dependents.append(b->path);
+        }
+    }
+
+    QFile file(path);
 
     if (file.remove()) {
-        beginRemoveRows(QModelIndex(), index, index);
 
-        delete m_backups.takeAt(index);
+        if (dependents.isEmpty()) {
+
+            beginRemoveRows(QModelIndex(), index, index);
+
+            delete m_backups.takeAt(index);
+
+            endRemoveRows();
 
-        endRemoveRows();
+        } else {
+
+            for (const QString &dependent : dependents) {
+                QFile::remove(dependent);
+            }
+
+            init();
+        }
     }
 
     setInOperation(false);
@@ -367,3 +570,31 @@ void BackupModel::setInOperation(bool nInOperation)
 }
 
 
+
+/*!
+ * \property BackupModel::progress
+ * \brief Progress of the currently created backup between \c 0.0 and \c 1.0.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>float</TD><TD>progress() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>progressChanged(float progress)</TD></TR></TABLE>
+ */
+
+/*!
+ * \brief Part of the \link BackupModel::progress progress \endlink property.
+ */
+float BackupModel::progress() const { return m_progress; }
+
+/*!
+ * \brief Part of the \link BackupModel::progress progress \endlink property.
+ */
+void BackupModel::setProgress(float nProgress)
+{
+    if (nProgress != m_progress) {
+        m_progress = nProgress;
+        emit progressChanged(progress());
+    }
+}
+
+
@@ -25,9 +25,16 @@
 #include <QDateTime>
 #include <QDir>
 #include <QLocale>
+#include <QPointer>
+#include <QVector>
 
 namespace Gibrievida {
 
+class BackupJob;
+class RestoreJob;
+class BackupScanner;
+struct BackupMetadata;
+
 /*!
  * \brief Contains information about a single backup.
  */
@@ -35,6 +42,15 @@ struct Backup {
     QDateTime time; /**< The time the backup has been created. */
     QString path; /**< Full path to the backup file. */
     QString size; /**< Size of the database backup file. */
+    bool compressed; /**< True if the backup file is gzip compressed. */
+    bool incremental; /**< True if the backup file only contains the changes since its parent backup. */
+    bool hasMetadata; /**< True if the following fields have been read from the backup. */
+    bool valid; /**< True if the backup contains a readable database. */
+    int schemaVersion; /**< Schema version of the database in the backup. */
+    int records; /**< Number of records in the backup. */
+    int activities; /**< Number of activities in the backup. */
+    QDateTime firstRecord; /**< Start time of the oldest record in the backup. */
+    QDateTime lastRecord; /**< Start time of the newest record in the backup. */
 };
 
 
@@ -44,13 +60,18 @@ struct Backup {
  * This model contains data about database backup files created by the user. It also provides methods
  * to create, restore and delete database backup files.
  *
+ * The database folder is scanned by a BackupScanner on its own thread. The list of backups is available
+ * first, further metadata like the number of records is filled in lazily and is cached between scans.
+ *
  * Backup files are stored in the database folder and are following a specific naming convention:
- * \c YYYYMMDDHHMMSS.backup.sqlite
+ * \c YYYYMMDDHHMMSS.backup.sqlite, \c YYYYMMDDHHMMSS.backup.sqlite.gz for compressed backups or
+ * \c YYYYMMDDHHMMSS.backup.delta for incremental backups.
  */
 class BackupModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(bool inOperation READ inOperation WRITE setInOperation NOTIFY inOperationChanged)
+    Q_PROPERTY(float progress READ progress NOTIFY progressChanged)
 public:
     explicit BackupModel(QObject *parent = nullptr);
     ~BackupModel();
@@ -63,7 +84,16 @@ public:
     enum Roles {
         Time = Qt::UserRole + 1,    /**< The time the backup hase been created. */
         Path,                       /**< The full path to the backup file. */
-        Size                        /**< Size of the database backup file. */
+        Size,                       /**< Size of the database backup file. */
+        Compressed,                 /**< True if the backup file is compressed. */
+        Incremental,                /**< True if the backup file is an incremental backup. */
+        HasMetadata,                /**< True if the content of the backup has been read. */
+        Valid,                      /**< True if the backup contains a readable database. */
+        SchemaVersion,              /**< Schema version of the database in the backup. */
+        Records,                    /**< Number of records in the backup. */
+        Activities,                 /**< Number of activities in the backup. */
+        FirstRecord,                /**< Start time of the oldest record in the backup. */
+        LastRecord                  /**< Start time of the newest record in the backup. */
     };
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
@@ -71,7 +101,8 @@ public:
     QModelIndex index(int row, int column = 0, const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
     QVariant data(const QModelIndex &index = QModelIndex(), int role = Qt::UserRole) const Q_DECL_OVERRIDE Q_DECL_FINAL;
 
-    Q_INVOKABLE void create();
+    Q_INVOKABLE void create(bool compressed = false);
+    Q_INVOKABLE void createIncremental();
     Q_INVOKABLE void restore(int index);
     Q_INVOKABLE void remove(int index);
     Q_INVOKABLE void removeAll();
@@ -79,20 +110,36 @@ public:
     bool inOperation() const;
     void setInOperation(bool nInOperation);
 
+    float progress() const;
+
 signals:
     void inOperationChanged(bool inOperation);
+    void progressChanged(float progress);
+    /*!
+     * \brief This signal is emitted after a backup has been restored, \a success is false if the backup was not usable.
+     */
+    void restored(bool success);
 
 private:
     Q_DISABLE_COPY(BackupModel)
 
     QList<Backup*> m_backups;
     bool m_inOperation;
+    float m_progress;
+    QPointer<BackupJob> m_backupJob;
+    QPointer<RestoreJob> m_restoreJob;
+    QPointer<BackupScanner> m_scanner;
 
     QDir m_dbdir;
     QLocale m_locale;
 
     void init();
     void clear();
+    void setBackups(const QVector<Gibrievida::BackupMetadata> &backups);
+    void updateBackup(const Gibrievida::BackupMetadata &backup);
+    void setMetadata(Backup *b, const BackupMetadata &m) const;
+    void setProgress(float nProgress);
+    void startBackup(const QString &path, const QString &parentPath);
 
 };
 
@@ -0,0 +1,338 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "backupscanner.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QVariant>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include "backupcompressor.h"
+#include "backupdelta.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#include <QElapsedTimer>
+#endif
+
+#define BACKUPSCANNER_CONNECTION_PREFIX "gibrievida_scan_"
+#define BACKUPSCANNER_CACHE_MAGIC 0x47424d43
+#define BACKUPSCANNER_CACHE_VERSION 1
+
+using namespace Gibrievida;
+
+QHash<QString, BackupMetadata> BackupScanner::s_cache;
+QMutex BackupScanner::s_cacheMutex;
+bool BackupScanner::s_cacheLoaded = false;
+static QAtomicInt s_lastScannerId;
+
+
+static QDataStream &operator<<(QDataStream &out, const BackupMetadata &m)
+{
+    out << m.path << m.modified << m.size << m.valid << static_cast<qint32>(m.schemaVersion) << static_cast<qint32>(m.records) << static_cast<qint32>(m.activities) << m.firstRecord << m.lastRecord;
+    return out;
+}
+
+
+static QDataStream &operator>>(QDataStream &in, BackupMetadata &m)
+{
+    qint32 schemaVersion = 0;
+    qint32 records = 0;
+    qint32 activities = 0;
+    in >> m.path >> m.modified >> m.size >> m.valid >> schemaVersion >> records >> activities >> m.firstRecord >> m.lastRecord;
+    m.schemaVersion = schemaVersion;
+    m.records = records;
+    m.activities = activities;
+    m.loaded = true;
+    return in;
+}
+
+
+/*!
+ * \brief Constructs a new scanner for the backups in \a directory.
+ */
+BackupScanner::BackupScanner(const QString &directory, QObject *parent) :
+    QThread(parent), m_directory(directory),
+    m_connectionName(QStringLiteral(BACKUPSCANNER_CONNECTION_PREFIX) + QString::number(s_lastScannerId.fetchAndAddOrdered(1) + 1))
+{
+    qRegisterMetaType<Gibrievida::BackupMetadata>("Gibrievida::BackupMetadata");
+    qRegisterMetaType<QVector<Gibrievida::BackupMetadata>>("QVector<Gibrievida::BackupMetadata>");
+}
+
+
+BackupScanner::~BackupScanner()
+{
+
+}
+
+
+/*!
+ * \brief The starting point for the thread.
+ */
+void BackupScanner::run()
+{
+#ifdef QT_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QStringList({QStringLiteral("*.backup.sqlite"), QStringLiteral("*.backup.sqlite.gz"), QStringLiteral("*.backup.delta")}), QDir::Files|QDir::Readable|QDir::Writable, QDir::Name|QDir::Reversed);
+
+    QVector<BackupMetadata> backups;
+    backups.reserve(files.size());
+
+    {
+        QMutexLocker locker(&s_cacheMutex);
+
+        loadCache();
+
+        for (const QFileInfo &fi : files) {
+            BackupMetadata m = s_cache.value(fi.absoluteFilePath());
+            if (!m.loaded || m.modified != fi.lastModified() || m.size != fi.size()) {
+                m = BackupMetadata();
+                m.path = fi.absoluteFilePath();
+                m.modified = fi.lastModified();
+                m.size = fi.size();
+            }
+            backups.append(m);
+        }
+    }
+
+    emit listed(backups);
+
+#ifdef QT_DEBUG
+    qDebug("Listed %i backups in %lli ms.", backups.size(), timer.elapsed());
+#endif
+
+    bool changed = false;
+
+    for (int i = 0; i < backups.size() && !isInterruptionRequested(); ++i) {
+
+        if (backups.at(i).loaded) {
+            continue;
+        }
+
+        backups[i] = read(files.at(i));
+        changed = true;
+
+        emit updated(backups.at(i));
+    }
+
+    QMutexLocker locker(&s_cacheMutex);
+
+    if (changed || s_cache.size() != backups.size()) {
+        saveCache(backups);
+    }
+
+#ifdef QT_DEBUG
+    qDebug("Scanned %i backups in %lli ms.", backups.size(), timer.elapsed());
+#endif
+}
+
+
+/*!
+ * \brief Reads the metadata of the backup file described by \a fileInfo.
+ *
+ * Compressed and incremental backups are restored to a temporary file that is read then.
+ */
+BackupMetadata BackupScanner::read(const QFileInfo &fileInfo) const
+{
+    BackupMetadata m;
+    m.path = fileInfo.absoluteFilePath();
+    m.modified = fileInfo.lastModified();
+    m.size = fileInfo.size();
+    m.loaded = true;
+
+    if (!BackupDelta::isDelta(m.path) && !BackupCompressor::isCompressed(m.path)) {
+        m.valid = readDatabase(m.path, m);
+        return m;
+    }
+
+    QTemporaryFile tmp(QDir::temp().absoluteFilePath(QStringLiteral("gibrievida-scan-XXXXXX")));
+
+    if (!tmp.open()) {
+        return m;
+    }
+
+    const QString tmpPath = tmp.fileName();
+    tmp.close();
+
+    const bool extracted = BackupDelta::isDelta(m.path) ? BackupDelta::restore(m.path, tmpPath) : BackupCompressor::decompress(m.path, tmpPath);
+
+    if (extracted) {
+        m.valid = readDatabase(tmpPath, m);
+    }
+
+    QFile::remove(tmpPath);
+
+    return m;
+}
+
+
+/*!
+ * \brief Reads schema version, counts and date range of the database at \a path into \a metadata.
+ *
+ * The database is opened read-only on the connection of this scanner, so a scanner that is replaced
+ * while it still runs does not share the connection with its successor. Returns false if it does not contain a Gibrievida database.
+ */
+bool BackupScanner::readDatabase(const QString &path, BackupMetadata &metadata) const
+{
+    bool valid = false;
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_connectionName);
+        db.setDatabaseName(path);
+        db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+
+        if (db.open()) {
+
+            QSqlQuery q(db);
+
+            if (q.exec(QStringLiteral("PRAGMA user_version")) && q.next()) {
+                metadata.schemaVersion = q.value(0).toInt();
+            }
+
+            // databases before the migration to user_version store it in the system table
+            if (metadata.schemaVersion == 0 && q.exec(QStringLiteral("SELECT value FROM system WHERE key = 'schema_version'")) && q.next()) {
+                metadata.schemaVersion = q.value(0).toInt();
+            }
+
+            if (q.exec(QStringLiteral("SELECT COUNT(*), MIN(start), MAX(start) FROM records")) && q.next()) {
+                metadata.records = q.value(0).toInt();
+                if (metadata.records > 0) {
+                    metadata.firstRecord = QDateTime::fromTime_t(q.value(1).toUInt());
+                    metadata.lastRecord = QDateTime::fromTime_t(q.value(2).toUInt());
+                }
+                valid = q.exec(QStringLiteral("SELECT COUNT(*) FROM activities")) && q.next();
+                if (valid) {
+                    metadata.activities = q.value(0).toInt();
+                }
+            }
+
+            if (!valid) {
+                qWarning("Failed to read metadata of backup %s: %s", qUtf8Printable(metadata.path), qUtf8Printable(q.lastError().text()));
+            }
+
+            q.finish();
+            db.close();
+
+        } else {
+            qWarning("Failed to open backup %s: %s", qUtf8Printable(metadata.path), qUtf8Printable(db.lastError().text()));
+        }
+    }
+
+    QSqlDatabase::removeDatabase(m_connectionName);
+
+    return valid;
+}
+
+
+/*!
+ * \brief Returns the path of the file containing the metadata cache.
+ */
+QString BackupScanner::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/backups.cache");
+}
+
+
+/*!
+ * \brief Loads the metadata cache from disk if not already done. s_cacheMutex has to be locked.
+ */
+void BackupScanner::loadCache()
+{
+    if (s_cacheLoaded) {
+        return;
+    }
+
+    s_cacheLoaded = true;
+
+    QFile f(cachePath());
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+
+    in >> magic >> version >> count;
+
+    if (magic != BACKUPSCANNER_CACHE_MAGIC || version != BACKUPSCANNER_CACHE_VERSION) {
+        return;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        BackupMetadata m;
+        in >> m;
+        if (in.status() == QDataStream::Ok) {
+            s_cache.insert(m.path, m);
+        }
+    }
+}
+
+
+/*!
+ * \brief Replaces the metadata cache with the loaded entries of \a backups and writes it to disk.
+ *
+ * s_cacheMutex has to be locked.
+ */
+void BackupScanner::saveCache(const QVector<BackupMetadata> &backups)
+{
+    // entries of removed backups are dropped
+    s_cache.clear();
+
+    for (const BackupMetadata &m : backups) {
+        if (m.loaded) {
+            s_cache.insert(m.path, m);
+        }
+    }
+
+    const QString path = cachePath();
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return;
+    }
+
+    QFile f(path);
+
+    if (!f.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        qWarning("Failed to write the backup metadata cache: %s", qUtf8Printable(f.errorString()));
+        return;
+    }
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    out << static_cast<quint32>(BACKUPSCANNER_CACHE_MAGIC) << static_cast<quint32>(BACKUPSCANNER_CACHE_VERSION) << static_cast<quint32>(s_cache.size());
+
+    for (const BackupMetadata &m : s_cache) {
+        out << m;
+    }
+}
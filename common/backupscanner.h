@@ -0,0 +1,103 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUPSCANNER_H
+#define BACKUPSCANNER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+
+class QFileInfo;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Contains the metadata of a single backup file.
+ */
+struct BackupMetadata {
+    QString path; /**< Full path to the backup file. */
+    QDateTime modified; /**< Last modification time of the backup file. */
+    qint64 size = 0; /**< Size of the backup file in bytes. */
+    bool loaded = false; /**< True if the content of the backup has been read. */
+    bool valid = false; /**< True if the backup contains a readable Gibrievida database. */
+    int schemaVersion = 0; /**< Schema version of the database in the backup. */
+    int records = 0; /**< Number of records in the backup. */
+    int activities = 0; /**< Number of activities in the backup. */
+    QDateTime firstRecord; /**< Start time of the oldest record in the backup. */
+    QDateTime lastRecord; /**< Start time of the newest record in the backup. */
+};
+
+
+/*!
+ * \brief Scans the backup directory on its own thread.
+ *
+ * The scanner first emits listed() with the file data of all backups and with the metadata
+ * already known from the cache. Afterwards, the content of backups without cached metadata is
+ * read read-only one by one and updated() is emitted for every backup.
+ *
+ * The metadata cache is shared by all scanners and is stored in the application cache directory.
+ * Entries are used as long as modification time and size of the backup file are unchanged.
+ */
+class BackupScanner : public QThread
+{
+    Q_OBJECT
+public:
+    explicit BackupScanner(const QString &directory, QObject *parent = nullptr);
+    ~BackupScanner();
+
+signals:
+    /*!
+     * \brief This signal is emitted with all \a backups found in the directory, newest first.
+     */
+    void listed(const QVector<Gibrievida::BackupMetadata> &backups);
+    /*!
+     * \brief This signal is emitted when the metadata of a single \a backup has been read.
+     */
+    void updated(const Gibrievida::BackupMetadata &backup);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    BackupMetadata read(const QFileInfo &fileInfo) const;
+    bool readDatabase(const QString &path, BackupMetadata &metadata) const;
+    static QString cachePath();
+    static void loadCache();
+    static void saveCache(const QVector<BackupMetadata> &backups);
+
+    static QHash<QString, BackupMetadata> s_cache;
+    static QMutex s_cacheMutex;
+    static bool s_cacheLoaded;
+
+    QString m_directory;
+    QString m_connectionName;
+
+    Q_DISABLE_COPY(BackupScanner)
+};
+
+}
+
+Q_DECLARE_METATYPE(Gibrievida::BackupMetadata)
+
+#endif // BACKUPSCANNER_H
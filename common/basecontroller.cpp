@@ -18,11 +18,10 @@
 */
 
 #include "basecontroller.h"
-#include <QStandardPaths>
 #include <QSqlQuery>
-#include <QStringBuilder>
-#include <QCoreApplication>
 #include "globals.h"
+#include "statementcache.h"
+#include "connectionpool.h"
 
 using namespace Gibrievida;
 
@@ -31,7 +30,6 @@ using namespace Gibrievida;
  */
 BaseController::BaseController(QObject *parent) : QObject(parent)
 {
-    m_db = QSqlDatabase::database();
 }
 
 
@@ -51,42 +49,24 @@ BaseController::~BaseController()
  */
 bool BaseController::connectDb()
 {
-    if (m_db.isValid() && m_db.isOpen()) {
-        return true;
-    }
-
-    if (!m_db.isValid()) {
-
-        const QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
-
-        if (dirs.isEmpty()) {
-            return false;
-        }
-
-        const QString dbPath = dirs.first() % QLatin1Char('/') % QCoreApplication::instance()->applicationName() % QStringLiteral("/database.sqlite");
-
-        m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"));
-        m_db.setDatabaseName(dbPath);
-
-        if (m_db.open()) {
-            QSqlQuery q(m_db);
-            q.exec(QStringLiteral("PRAGMA foreign_keys = ON"));
-            return true;
-        } else {
-            return false;
-        }
+    m_db = ConnectionPool::database();
+    return m_db.isOpen();
+}
 
-    } else if (!m_db.isOpen()) {
 
-        if (m_db.open()) {
-            QSqlQuery q(m_db);
-            q.exec(QStringLiteral("PRAGMA foreign_keys = ON"));
-            return true;
-        } else {
-            return false;
-        }
 
+/*!
+ * \brief Returns the cached prepared statement \c id for the database connection.
+ *
+ * The statement will be prepared from \c sql on first use and taken from the StatementCache
+ * on later calls, only the values have to be bound again. Returns a \c nullptr if the database
+ * connection could not be established or if the statement could not be prepared.
+ */
+QSqlQuery *BaseController::prepared(const QString &id, const QString &sql)
+{
+    if (!connectDb()) {
+        return nullptr;
     }
 
-    return false;
+    return StatementCache::prepare(m_db, id, sql);
 }
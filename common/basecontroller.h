@@ -23,13 +23,15 @@
 #include <QObject>
 #include <QSqlDatabase>
 
+class QSqlQuery;
+
 namespace Gibrievida {
 
 /*!
  * \brief Base controller class.
  *
  * Other conroller classes should be subclasses of this class. The BaseController provides
- * methods to connect to the database.
+ * methods to connect to the database and to get cached prepared statements.
  */
 class BaseController : public QObject
 {
@@ -40,7 +42,8 @@ public:
 
 protected:
     bool connectDb();
-    QSqlDatabase m_db;  /*!< Contains the default database. */
+    QSqlQuery *prepared(const QString &id, const QString &sql);
+    QSqlDatabase m_db;  /*!< Contains the database connection of the GUI thread, set by connectDb(). */
 
 private:
     Q_DISABLE_COPY(BaseController)
@@ -54,20 +54,20 @@ int CategoriesController::add(const QString &name, const QString &color)
         return -1;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("categories_insert"), QStringLiteral("INSERT INTO categories (name, color) VALUES (?, ?)"));
 
-    if (!q.prepare(QStringLiteral("INSERT INTO categories (name, color) VALUES (?, ?)"))) {
+    if (!q) {
         return -1;
     }
 
-    q.addBindValue(name);
-    q.addBindValue(color);
+    q->addBindValue(name);
+    q->addBindValue(color);
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         return -1;
     }
 
-    int id = q.lastInsertId().toInt();
+    int id = q->lastInsertId().toInt();
 
     emit added(id, name, color);
 
@@ -86,17 +86,17 @@ bool CategoriesController::update(Category *c)
         return false;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("categories_update"), QStringLiteral("UPDATE categories SET name = ?, color = ? WHERE id = ?"));
 
-    if (!q.prepare(QStringLiteral("UPDATE categories SET name = ?, color = ? WHERE id = ?"))) {
+    if (!q) {
         return false;
     }
 
-    q.addBindValue(c->name());
-    q.addBindValue(c->color());
-    q.addBindValue(c->databaseId());
+    q->addBindValue(c->name());
+    q->addBindValue(c->color());
+    q->addBindValue(c->databaseId());
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         return false;
     }
 
@@ -118,15 +118,15 @@ bool CategoriesController::remove(Category *c)
         return false;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("categories_delete"), QStringLiteral("DELETE FROM categories WHERE id = ?"));
 
-    if (!q.prepare(QStringLiteral("DELETE FROM categories WHERE id = ?"))) {
+    if (!q) {
         return false;
     }
 
-    q.addBindValue(c->databaseId());
+    q->addBindValue(c->databaseId());
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         return false;
     }
 
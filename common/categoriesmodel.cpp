@@ -23,6 +23,7 @@
 #include "activitiescontroller.h"
 #include "category.h"
 #include "activity.h"
+#include "registry.h"
 
 using namespace Gibrievida;
 
@@ -34,6 +35,8 @@ CategoriesModel::CategoriesModel(QObject *parent) : DBModel(parent)
     m_controller = nullptr;
     m_actsController = nullptr;
     init();
+
+    connect(Registry::instance(), &Registry::reloaded, this, &CategoriesModel::init);
 }
 
 
@@ -106,36 +109,39 @@ QVariant CategoriesModel::data(const QModelIndex &index, int role) const
 
 
 /*!
- * \brief Initializes the model data from the SQL database.
+ * \brief Returns the query that loads all categories sorted by name.
  */
-void CategoriesModel::init()
+QString CategoriesModel::loadQuery()
 {
-    setInOperation(true);
+    return QStringLiteral("SELECT c.id, c.name, c.color, c.activity_count FROM categories c ORDER BY name ASC");
+}
 
-    clear();
 
-    if (!connectDb()) {
-        setInOperation(false);
-        return;
-    }
 
-    QSqlQuery q(m_db);
+/*!
+ * \brief Initializes the model data from the SQL database.
+ */
+void CategoriesModel::init()
+{
+    startQuery(loadQuery());
+}
 
-    if (!q.prepare(QStringLiteral("SELECT c.id, c.name, c.color, (SELECT COUNT(id) FROM activities WHERE category = c.id) AS activities FROM categories c ORDER BY name ASC"))) {
-        setInOperation(false);
-        return;
-    }
 
-    if (!q.exec()) {
-        setInOperation(false);
-        return;
-    }
+
+/*!
+ * \brief Populates the model with the loaded categories.
+ */
+void CategoriesModel::queryFinished(const DBRows &rows)
+{
+    clear();
 
     QList<Category*> t_categories;
+    t_categories.reserve(rows.size());
+
+    Registry *registry = Registry::instance();
 
-    while (q.next()) {
-        Category *c = new Category(q.value(0).toInt(), q.value(1).toString(), q.value(2).toString(), q.value(3).toInt(), this);
-        t_categories.append(c);
+    for (const QVariantList &row : rows) {
+        t_categories.append(registry->category(row.at(0).toInt(), row.at(1).toString(), row.at(2).toString(), row.at(3).toInt()));
     }
 
     if (!t_categories.isEmpty()) {
@@ -143,16 +149,17 @@ void CategoriesModel::init()
         beginInsertRows(QModelIndex(), 0, t_categories.size()-1);
 
         m_categories = t_categories;
+        reindex(0);
 
         endInsertRows();
     }
-
-    setInOperation(false);
 }
 
 
 /*!
  * \brief Clears the model and removes all model data.
+ *
+ * The Category objects are owned by the Registry and will not be destroyed.
  */
 void CategoriesModel::clear()
 {
@@ -160,8 +167,8 @@ void CategoriesModel::clear()
 
         beginRemoveRows(QModelIndex(), 0, rowCount()-1);
 
-        qDeleteAll(m_categories);
         m_categories.clear();
+        m_rows.clear();
 
         endRemoveRows();
     }
@@ -183,7 +190,9 @@ void CategoriesModel::remove(int databaseId)
 
     beginRemoveRows(QModelIndex(), idx, idx);
 
-    delete m_categories.takeAt(idx);
+    m_categories.removeAt(idx);
+    m_rows.remove(databaseId);
+    reindex(idx);
 
     endRemoveRows();
 }
@@ -205,10 +214,17 @@ void CategoriesModel::removeAll()
  */
 void CategoriesModel::add(int databaseId, const QString &name, const QString &color)
 {
+    Registry *registry = Registry::instance();
+
+    Category *c = registry->category(databaseId);
+    if (!c) {
+        c = registry->category(databaseId, name, color, 0);
+    }
+
     beginInsertRows(QModelIndex(), rowCount(), rowCount());
 
-    Category *c = new Category(databaseId, name, color, 0, this);
     m_categories.append(c);
+    m_rows.insert(c->databaseId(), m_categories.size()-1);
 
     endInsertRows();
 }
@@ -224,102 +240,19 @@ void CategoriesModel::add(int databaseId, const QString &name, const QString &co
  */
 int CategoriesModel::find(int databaseId)
 {
-    int idx = -1;
-
-    if (m_categories.isEmpty()) {
-        return idx;
-    }
-
-    for (int i = 0; i < m_categories.size(); ++i) {
-        if (m_categories.at(i)->databaseId() == databaseId) {
-            idx = i;
-            break;
-        }
-    }
-
-    return idx;
+    return m_rows.value(databaseId, -1);
 }
 
 
 
-
 /*!
- * \brief This slot updates the model after a new Activity has been added.
+ * \brief Updates the row index of the model items starting at \a row.
  */
-void CategoriesModel::addActivity(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool useDistance)
+void CategoriesModel::reindex(int row)
 {
-    Q_UNUSED(databaseId)
-    Q_UNUSED(name)
-    Q_UNUSED(minRepeats)
-    Q_UNUSED(maxRepeats)
-    Q_UNUSED(useDistance)
-
-    int idx = find(c->databaseId());
-
-    if (idx < 0) {
-        return;
+    for (int i = row; i < m_categories.size(); ++i) {
+        m_rows.insert(m_categories.at(i)->databaseId(), i);
     }
-
-    m_categories.at(idx)->increaseActivities();
-}
-
-
-
-/*!
- * \brief This slot updates the model after an Activity has been changed.
- */
-void CategoriesModel::updateActivity(Activity *a, int oldCategoryId)
-{
-    if (a->category()->databaseId() != oldCategoryId) {
-        int idx = find(oldCategoryId);
-
-        if (idx > -1) {
-            m_categories.at(idx)->decreaseActivities();
-        }
-
-        idx = find(a->category()->databaseId());
-
-        if (idx > -1) {
-            m_categories.at(idx)->increaseActivities();
-        }
-    }
-}
-
-
-
-/*!
- * \brief This slot updates the model after an Activity has been removed.
- */
-void CategoriesModel::removeActivity(int databaseId, int category)
-{
-    Q_UNUSED(databaseId);
-
-    int idx = find(category);
-
-    if (idx < 0) {
-        return;
-    }
-
-    m_categories.at(idx)->decreaseActivities();
-}
-
-
-
-
-
-/*!
- * \brief This slot updates the model after all activities have been removed.
- */
-void CategoriesModel::removeAllActivities()
-{
-    if (m_categories.isEmpty()) {
-        return;
-    }
-
-    for (int i = 0; i < m_categories.size(); ++i) {
-        m_categories.at(i)->setActivities(0);
-    }
-
 }
 
 
@@ -360,21 +293,7 @@ CategoriesController *CategoriesModel::getCategoriesController() const
  */
 void CategoriesModel::setActivitiesController(ActivitiesController *controller)
 {
-    if (controller != m_actsController) {
-        if (m_actsController) {
-            disconnect(m_actsController, &ActivitiesController::added, this, &CategoriesModel::addActivity);
-            disconnect(m_actsController, &ActivitiesController::updated, this, &CategoriesModel::updateActivity);
-            disconnect(m_actsController, &ActivitiesController::removed, this, &CategoriesModel::removeActivity);
-            disconnect(m_actsController, &ActivitiesController::removedAll, this, &CategoriesModel::removeAllActivities);
-        }
-        m_actsController = controller;
-        if (m_actsController) {
-            connect(m_actsController, &ActivitiesController::added, this, &CategoriesModel::addActivity);
-            connect(m_actsController, &ActivitiesController::updated, this, &CategoriesModel::updateActivity);
-            connect(m_actsController, &ActivitiesController::removed, this, &CategoriesModel::removeActivity);
-            connect(m_actsController, &ActivitiesController::removedAll, this, &CategoriesModel::removeAllActivities);
-        }
-    }
+    m_actsController = controller;
 }
 
 
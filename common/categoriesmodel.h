@@ -33,7 +33,8 @@ class Activity;
 /*!
  * \brief Model containing a set of Category objects.
  *
- * The model will be populated on construction from the SQL database.
+ * The model will be populated on construction from the SQL database in the background.
+ * The model items are the canonical Category objects from the Registry, the activities counts are maintained by the Registry.
  */
 class CategoriesModel : public DBModel
 {
@@ -62,21 +63,21 @@ public:
     void setActivitiesController(ActivitiesController *controller);
     ActivitiesController *getActivitiesController() const;
 
+    static QString loadQuery();
+
 public slots:
     void add(int databaseId, const QString &name, const QString &color);
     void remove(int databaseId);
     void removeAll();
 
-    void addActivity(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool useDistance);
-    void updateActivity(Activity *a, int oldCategoryId);
-    void removeActivity(int databaseId, int category);
-    void removeAllActivities();
-
 private:
     QList<Category*> m_categories;
+    QHash<int, int> m_rows;
     void init();
+    void queryFinished(const DBRows &rows) Q_DECL_OVERRIDE;
     void clear();
     int find(int databaseId);
+    void reindex(int row);
     CategoriesController *m_controller;
     ActivitiesController *m_actsController;
 
@@ -20,7 +20,22 @@ HEADERS += \
     $$PWD/activity.h \
     $$PWD/record.h \
     $$PWD/backupmodel.h \
-    $$PWD/distancemeasurement.h
+    $$PWD/distancemeasurement.h \
+    $$PWD/dbworker.h \
+    $$PWD/registry.h \
+    $$PWD/statementcache.h \
+    $$PWD/connectionpool.h \
+    $$PWD/recordwriter.h \
+    $$PWD/backupjob.h \
+    $$PWD/restorejob.h \
+    $$PWD/backupcompressor.h \
+    $$PWD/backupdelta.h \
+    $$PWD/backupscanner.h \
+    $$PWD/rollups.h \
+    $$PWD/activitystatisticsmodel.h \
+    $$PWD/personalbests.h \
+    $$PWD/queryplancheck.h \
+    $$PWD/migrationstatus.h
 
 SOURCES += \
     $$PWD/dbmanager.cpp \
@@ -41,4 +56,19 @@ SOURCES += \
     $$PWD/activity.cpp \
     $$PWD/record.cpp \
     $$PWD/backupmodel.cpp \
-    $$PWD/distancemeasurement.cpp
+    $$PWD/distancemeasurement.cpp \
+    $$PWD/dbworker.cpp \
+    $$PWD/registry.cpp \
+    $$PWD/statementcache.cpp \
+    $$PWD/connectionpool.cpp \
+    $$PWD/recordwriter.cpp \
+    $$PWD/backupjob.cpp \
+    $$PWD/restorejob.cpp \
+    $$PWD/backupcompressor.cpp \
+    $$PWD/backupdelta.cpp \
+    $$PWD/backupscanner.cpp \
+    $$PWD/rollups.cpp \
+    $$PWD/activitystatisticsmodel.cpp \
+    $$PWD/personalbests.cpp \
+    $$PWD/queryplancheck.cpp \
+    $$PWD/migrationstatus.cpp
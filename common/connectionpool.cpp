@@ -0,0 +1,195 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "connectionpool.h"
+#include <QThreadStorage>
+#include <QSqlQuery>
+#include <QAtomicInt>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QStringBuilder>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QFile>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dbmanager.h"
+#include "statementcache.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+#define CONNECTIONPOOL_NAME_PREFIX "gibrievida_"
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Owns the database connection of a single thread.
+ *
+ * Instances are stored in a QThreadStorage, that deletes them when the thread exits.
+ */
+struct ThreadConnection {
+    QString name;
+
+    ~ThreadConnection()
+    {
+        StatementCache::clear(name);
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            if (db.isOpen()) {
+                // refreshes the planner statistics that are outdated, the ANALYZE of the migration ran on the data of that time
+                QSqlQuery q(db);
+                q.exec(QStringLiteral("PRAGMA optimize"));
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+#ifdef QT_DEBUG
+        qDebug("Removed database connection %s", qUtf8Printable(name));
+#endif
+    }
+};
+
+static QThreadStorage<ThreadConnection*> s_connections;
+static QAtomicInt s_lastConnectionId;
+
+
+/*!
+ * \brief Returns the path of the database file.
+ *
+ * Returns an empty string if there is no writable data location.
+ */
+QString ConnectionPool::databasePath()
+{
+    const QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+
+    if (dirs.isEmpty()) {
+        return QString();
+    }
+
+    return dirs.first() % QLatin1Char('/') % QCoreApplication::instance()->applicationName() % QStringLiteral("/database.sqlite");
+}
+
+
+/*!
+ * \brief Returns the open database connection of the calling thread.
+ *
+ * The connection will be created on the first call in a thread and reopened if it has been closed.
+ * After opening, the pragmas of DBManager::applyPragmas() will be applied. Check QSqlDatabase::isOpen()
+ * on the returned object to see if the connection could be established.
+ */
+QSqlDatabase ConnectionPool::database()
+{
+    if (!s_connections.hasLocalData()) {
+
+        const QString path = databasePath();
+
+        if (path.isEmpty()) {
+            return QSqlDatabase();
+        }
+
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        ThreadConnection *tc = new ThreadConnection;
+        tc->name = QStringLiteral(CONNECTIONPOOL_NAME_PREFIX) % QString::number(s_lastConnectionId.fetchAndAddOrdered(1) + 1);
+
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), tc->name);
+        db.setDatabaseName(path);
+
+        s_connections.setLocalData(tc);
+
+#ifdef QT_DEBUG
+        qDebug("Added database connection %s", qUtf8Printable(tc->name));
+#endif
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(s_connections.localData()->name, false);
+
+    if (!db.isOpen()) {
+
+        // statements prepared on a closed connection are not usable anymore
+        StatementCache::clear(db.connectionName());
+
+        if (db.open()) {
+            DBManager::applyPragmas(db);
+        } else {
+            qWarning("Failed to open database connection %s", qUtf8Printable(db.connectionName()));
+        }
+    }
+
+    return db;
+}
+
+
+/*!
+ * \brief Closes the database connection of the calling thread.
+ *
+ * The cached statements of the connection will be removed. The next call to database() will reopen the connection.
+ */
+void ConnectionPool::close()
+{
+    if (!s_connections.hasLocalData()) {
+        return;
+    }
+
+    const QString name = s_connections.localData()->name;
+
+    StatementCache::clear(name);
+
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    db.close();
+}
+
+
+/*!
+ * \brief Replaces the database file by \a file.
+ *
+ * All connections to the database have to be closed before calling this. Remaining write-ahead
+ * log and shared memory files are removed, afterwards \a file is atomically renamed to the database
+ * path, so that either the old or the new database is in place if the application crashes.
+ * Returns true on success.
+ */
+bool ConnectionPool::replaceDatabase(const QString &file)
+{
+    const QString path = databasePath();
+
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    // a remaining write-ahead log would be applied to the new database
+    QFile::remove(path + QLatin1String("-wal"));
+    QFile::remove(path + QLatin1String("-shm"));
+
+    if (std::rename(QFile::encodeName(file).constData(), QFile::encodeName(path).constData()) != 0) {
+        qWarning("Failed to replace the database by %s", qUtf8Printable(file));
+        return false;
+    }
+
+    // persist the rename in the directory entry
+    const int dir = ::open(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), O_RDONLY);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+
+    return true;
+}
@@ -0,0 +1,51 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QString>
+#include <QSqlDatabase>
+
+namespace Gibrievida {
+
+/*!
+ * \brief Provides a named database connection for every thread.
+ *
+ * A QSqlDatabase connection must only be used in the thread that created it. database() returns
+ * the connection of the calling thread and creates and opens it on first use, with the pragma
+ * profile of DBManager applied. The connection of a thread is closed and removed together with
+ * its cached statements when the thread exits, so do not keep copies of the returned
+ * QSqlDatabase object in objects that outlive their thread.
+ */
+class ConnectionPool
+{
+public:
+    static QSqlDatabase database();
+    static void close();
+    static QString databasePath();
+    static bool replaceDatabase(const QString &file);
+
+private:
+    ConnectionPool();
+};
+
+}
+
+#endif // CONNECTIONPOOL_H
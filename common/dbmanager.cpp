@@ -19,29 +19,54 @@
 
 #include "dbmanager.h"
 #include "globals.h"
+#include "connectionpool.h"
+#include "rollups.h"
+#include "personalbests.h"
+#include "queryplancheck.h"
 
 #include <QVariant>
-#include <QStandardPaths>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStringList>
-#include <QDir>
-#include <QCoreApplication>
 #include <QStringBuilder>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
 
 #include "globals.h"
 
-#define DB_SCHEMA_VERSION 2
+#define DB_MIGRATION_CHUNK_SIZE 1000
 
 using namespace Gibrievida;
 
+static QMutex s_readyMutex;
+static bool s_ready = false;
+static DBManager *s_instance = nullptr;
+
+static QMutex s_pragmaMutex;
+static DBManager::PragmaProfile s_pragmaProfile = {
+    QStringLiteral(DB_PRAGMA_JOURNAL_MODE),
+    QStringLiteral(DB_PRAGMA_SYNCHRONOUS),
+    DB_PRAGMA_CACHE_SIZE,
+    DB_PRAGMA_MMAP_SIZE,
+    QStringLiteral(DB_PRAGMA_TEMP_STORE)
+};
+
 /*!
  * \brief Constructs a new database manager.
  */
 DBManager::DBManager(QObject *parent) : QThread(parent)
 {
+    m_fatal = true;
 
+    QMutexLocker locker(&s_readyMutex);
+    if (!s_instance) {
+        s_instance = this;
+    }
 }
 
 /*!
@@ -49,68 +74,328 @@ DBManager::DBManager(QObject *parent) : QThread(parent)
  */
 DBManager::~DBManager()
 {
-
+    QMutexLocker locker(&s_readyMutex);
+    if (s_instance == this) {
+        s_instance = nullptr;
+    }
 }
 
 
 /*!
  * \brief The starting point for the thread.
  *
- * This will call createDatabase().
+ * Checks the database schema via initDatabase() and emits ready() afterwards, regardless of the
+ * result, so that waiting consumers are not blocked forever.
  */
 void DBManager::run()
 {
-    const QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+    initDatabase();
+
+    setReady();
+}
+
+
+/*!
+ * \brief Opens the database on the connection of the manager thread and brings its schema up to date via migrate().
+ */
+void DBManager::initDatabase()
+{
+    m_db = ConnectionPool::database();
 
-    if (dirs.isEmpty()) {
+    if (!m_db.isOpen()) {
+        fatalError("Failed to open database", m_db.lastError());
         return;
     }
 
-    QString dbpath = dirs.first() % QLatin1Char('/') % QCoreApplication::instance()->applicationName();
+    if (migrate()) {
+#ifdef QT_DEBUG
+        QueryPlanCheck::run(m_db);
+        QSqlQuery q(m_db);
+        if (!Rollups::check(q)) {
+            qWarning("The statistics rollups are not consistent with the records.");
+        }
+#endif
+    }
+
+    // the connection will be removed by the ConnectionPool when the thread exits
+    m_db = QSqlDatabase();
+}
+
 
-    QDir dbdir(dbpath);
-    if (!dbdir.exists()) {
-        dbdir.mkpath(dbpath);
+/*!
+ * \brief Upgrades the schema of the database file at \a databasePath to DB_SCHEMA_VERSION.
+ *
+ * This runs the same migration steps as the start up check, but on its own connection in the
+ * calling thread, and is used for restored backups. Errors are not fatal, returns false if the
+ * database could not be upgraded.
+ */
+bool DBManager::upgrade(const QString &databasePath)
+{
+    const QString connectionName = QStringLiteral("gibrievida_upgrade");
+    bool ok = false;
+
+    {
+        DBManager manager;
+        manager.m_fatal = false;
+
+        manager.m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
+        manager.m_db.setDatabaseName(databasePath);
+
+        if (manager.m_db.open()) {
+            QSqlQuery q(manager.m_db);
+            q.exec(QStringLiteral("PRAGMA foreign_keys = ON"));
+            ok = manager.migrate();
+            manager.m_db.close();
+        } else {
+            qWarning("Failed to open %s: %s", qUtf8Printable(databasePath), qUtf8Printable(manager.m_db.lastError().text()));
+        }
+
+        manager.m_db = QSqlDatabase();
     }
 
-    dbpath.append(QStringLiteral("/database.sqlite"));
+    QSqlDatabase::removeDatabase(connectionName);
+
+    return ok;
+}
 
-    m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"));
-    m_db.setDatabaseName(dbpath);
 
-    if (!m_db.open()) {
-        fatalError("Failed to open database", m_db.lastError());
+/*!
+ * \brief Marks the database as ready and emits the ready() signal.
+ */
+void DBManager::setReady()
+{
+    QMutexLocker locker(&s_readyMutex);
+    s_ready = true;
+    emit ready();
+}
+
+
+/*!
+ * \brief Returns true if the database schema check has been finished.
+ *
+ * This function is thread-safe.
+ */
+bool DBManager::isReady()
+{
+    QMutexLocker locker(&s_readyMutex);
+    return s_ready;
+}
+
+
+/*!
+ * \brief Calls \a func in the thread of \a context as soon as the database is ready.
+ *
+ * If the database is already ready, \a func will be called on the next event loop iteration.
+ * Otherwise it will be called when the ready() signal has been emitted. \a func will not be
+ * called if \a context has been destroyed before. This function is thread-safe.
+ */
+void DBManager::whenReady(QObject *context, const std::function<void()> &func)
+{
+    QMutexLocker locker(&s_readyMutex);
+
+    if (!s_ready && s_instance) {
+        connect(s_instance, &DBManager::ready, context, func);
+    } else {
+        QTimer::singleShot(0, context, func);
     }
+}
 
-    if (!createDatabase()) {
-        return;
+
+/*!
+ * \brief Returns the ordered list of schema migrations.
+ *
+ * Every step upgrades the schema by exactly one version. To change the schema, add a new
+ * updateToSchemaVx() function, append it here and increase DB_SCHEMA_VERSION.
+ */
+const QVector<DBManager::Migration> &DBManager::migrations()
+{
+    static const QVector<Migration> steps({
+                                              {1, &DBManager::updateToSchemaV1},
+                                              {2, &DBManager::updateToSchemaV2},
+                                              {3, &DBManager::updateToSchemaV3},
+                                              {4, &DBManager::updateToSchemaV4},
+                                              {5, &DBManager::updateToSchemaV5},
+                                              {6, &DBManager::updateToSchemaV6},
+                                              {7, &DBManager::updateToSchemaV7},
+                                              {8, &DBManager::updateToSchemaV8}
+                                          });
+    return steps;
+}
+
+
+/*!
+ * \brief Returns the schema version of the database.
+ *
+ * The version is stored in PRAGMA user_version. Databases created before that stored it in the
+ * system table. If such a version is found, it is moved to user_version once.
+ */
+int DBManager::schemaVersion()
+{
+    QSqlQuery q(m_db);
+
+    if (!q.exec(QStringLiteral("PRAGMA user_version")) || !q.next()) {
+        fatalError("Failed to query database schema version", q.lastError());
+        return -1;
     }
 
-    if (!updateDatabase()) {
-        return;
+    const int version = q.value(0).toInt();
+
+    if (version > 0) {
+        return version;
+    }
+
+    if (!q.exec(QStringLiteral("SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'system'")) || !q.next()) {
+        return 0;
+    }
+
+    if (!q.exec(QStringLiteral("SELECT value FROM system WHERE key = 'schema_version'")) || !q.next()) {
+        return 0;
+    }
+
+    const int legacyVersion = q.value(0).toInt();
+
+    qDebug("Moving schema version %i from the system table to user_version", legacyVersion);
+
+    if (!m_db.transaction()) {
+        fatalError("Failed to create database transaction", m_db.lastError());
+        return -1;
+    }
+
+    if (!q.exec(QStringLiteral("PRAGMA user_version = %1").arg(legacyVersion))) {
+        m_db.rollback();
+        fatalError("Failed to set database schema version", q.lastError());
+        return -1;
+    }
+
+    if (!q.exec(QStringLiteral("DELETE FROM system WHERE key = 'schema_version'"))) {
+        m_db.rollback();
+        fatalError("Failed to remove legacy schema version", q.lastError());
+        return -1;
+    }
+
+    if (!m_db.commit()) {
+        fatalError("Failed to commit database transaction", m_db.lastError());
+        return -1;
     }
+
+    return legacyVersion;
 }
 
 
 /*!
- * \brief Creates the database tables.
+ * \brief Brings the database schema up to DB_SCHEMA_VERSION.
+ *
+ * Runs every migration step with a higher version than the current schema version in its own
+ * transaction, that also sets PRAGMA user_version to the version of the step. If the schema is
+ * already current, this returns after reading the version.
  */
-bool DBManager::createDatabase()
+bool DBManager::migrate()
 {
-    qDebug("Checking basic database schema");
+    const int currentVersion = schemaVersion();
+
+    if (currentVersion == DB_SCHEMA_VERSION) {
+        return true;
+    }
+
+    if (currentVersion < 0) {
+        return false;
+    }
+
+    if (currentVersion > DB_SCHEMA_VERSION) {
+        qWarning("Database schema version %i is newer than the supported version %i", currentVersion, DB_SCHEMA_VERSION);
+        return false;
+    }
+
+    emit migrationStarted(currentVersion, DB_SCHEMA_VERSION);
 
     QSqlQuery q(m_db);
 
-    if (!q.exec(QStringLiteral("PRAGMA foreign_keys = ON"))) {
-        fatalError("Failed to activate foreign keys support", q.lastError());
+    for (const Migration &migration : migrations()) {
+
+        if (migration.version <= currentVersion) {
+            continue;
+        }
+
+        if (!m_db.transaction()) {
+            fatalError("Failed to create database transaction", m_db.lastError());
+            return false;
+        }
+
+        if (!(this->*migration.apply)(q)) {
+            m_db.rollback();
+            return false;
+        }
+
+        if (!q.exec(QStringLiteral("PRAGMA user_version = %1").arg(migration.version))) {
+            m_db.rollback();
+            fatalError("Failed to set database schema version", q.lastError());
+            return false;
+        }
+
+        if (!m_db.commit()) {
+            fatalError("Failed to commit database transaction", m_db.lastError());
+            return false;
+        }
+
+        emit migrationProgress(migration.version, 100);
+    }
+
+    emit migrationFinished(DB_SCHEMA_VERSION);
+
+    return true;
+}
+
+
+/*!
+ * \brief Executes an UPDATE or INSERT \a statement on \a table in chunks of DB_MIGRATION_CHUNK_SIZE rows.
+ *
+ * The \a statement must not have a WHERE clause on \a table, the chunks are selected by ranges of the id column.
+ * After every chunk migrationProgress() is emitted for the migration step \a version, so the progress
+ * of long running upgrades can be shown.
+ */
+bool DBManager::updateInChunks(QSqlQuery &q, int version, const QString &table, const QString &statement)
+{
+    if (!q.exec(QStringLiteral("SELECT MIN(id), MAX(id) FROM ") % table) || !q.next()) {
         return false;
     }
 
-    if (!m_db.transaction()) {
-        fatalError("Failed to create database transaction", q.lastError());
+    if (q.value(0).isNull()) {
+        return true;
+    }
+
+    const qint64 minId = q.value(0).toLongLong();
+    const qint64 maxId = q.value(1).toLongLong();
+    const qint64 total = maxId - minId + 1;
+
+    if (!q.prepare(statement % QLatin1String(" WHERE id >= ? AND id <= ?"))) {
         return false;
     }
 
+    for (qint64 from = minId; from <= maxId; from += DB_MIGRATION_CHUNK_SIZE) {
+
+        const qint64 to = qMin(from + DB_MIGRATION_CHUNK_SIZE - 1, maxId);
+
+        q.addBindValue(from);
+        q.addBindValue(to);
+
+        if (!q.exec()) {
+            return false;
+        }
+
+        emit migrationProgress(version, static_cast<int>((to - minId + 1) * 100 / total));
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Creates the basic database tables of schema version 1.
+ */
+bool DBManager::updateToSchemaV1(QSqlQuery &q)
+{
+    qDebug("Create basic database schema");
+
     if (!q.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS categories "
                                "(id INTEGER PRIMARY KEY NOT NULL, "
                                "name TEXT NOT NULL, "
@@ -162,8 +447,33 @@ bool DBManager::createDatabase()
         return false;
     }
 
-    if (!m_db.commit()) {
-        fatalError("Failed to execute database transaction", q.lastError());
+    return true;
+}
+
+
+/*!
+ * \brief Upgrade database schema to version 2.
+ */
+bool DBManager::updateToSchemaV2(QSqlQuery &q)
+{
+    qDebug("Update database to schema version 2");
+
+    if(!q.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS system "
+                              "(id INTEGER PRIMARY KEY NOT NULL, "
+                              "key TEXT NOT NULL, "
+                              "value TEXT NOT NULL)"
+                              ))) {
+        fatalError("Failed to create system table", q.lastError());
+        return false;
+    }
+
+    if (!q.exec(QStringLiteral("ALTER TABLE activities ADD COLUMN sensor INTEGER DEFAULT 0"))) {
+        fatalError("Failed to add column sensor to table activities", q.lastError());
+        return false;
+    }
+
+    if (!q.exec(QStringLiteral("ALTER TABLE activities ADD COLUMN sensorDelay INTEGER DEFAULT 0"))) {
+        fatalError("Failed to add column sensorDelay to table activities", q.lastError());
         return false;
     }
 
@@ -172,38 +482,102 @@ bool DBManager::createDatabase()
 
 
 /*!
- * \brief Check if the database schema has to be upgraded.
+ * \brief Upgrade database schema to version 3.
+ *
+ * Adds the record_count column to the activities table and the activity_count column to the categories
+ * table. Both columns are kept up to date by triggers, so the models do not have to count the records
+ * and activities on every load.
  */
-bool DBManager::updateDatabase()
+bool DBManager::updateToSchemaV3(QSqlQuery &q)
 {
-    int db_schema_version = 0;
+    qDebug("Update database to schema version 3");
 
-    QSqlQuery q(m_db);
-
-    if (q.exec(QStringLiteral("SELECT value FROM system WHERE key = 'schema_version'"))) {
-        if (q.next()) {
-            db_schema_version = q.value(0).toInt();
-        }
+    if (!q.exec(QStringLiteral("ALTER TABLE activities ADD COLUMN record_count INTEGER NOT NULL DEFAULT 0"))) {
+        fatalError("Failed to add column record_count to table activities", q.lastError());
+        return false;
     }
 
-    if (db_schema_version < DB_SCHEMA_VERSION) {
-        return updateToSchemaV2();
+    if (!q.exec(QStringLiteral("ALTER TABLE categories ADD COLUMN activity_count INTEGER NOT NULL DEFAULT 0"))) {
+        fatalError("Failed to add column activity_count to table categories", q.lastError());
+        return false;
     }
 
-    if (db_schema_version < DB_SCHEMA_VERSION) {
+    if (!updateInChunks(q, 3, QStringLiteral("activities"), QStringLiteral("UPDATE activities SET record_count = (SELECT COUNT(id) FROM records WHERE activity = activities.id)"))) {
+        fatalError("Failed to initialize record counts", q.lastError());
+        return false;
+    }
 
-        qDebug("Updating database schema version");
+    if (!updateInChunks(q, 3, QStringLiteral("categories"), QStringLiteral("UPDATE categories SET activity_count = (SELECT COUNT(id) FROM activities WHERE category = categories.id)"))) {
+        fatalError("Failed to initialize activity counts", q.lastError());
+        return false;
+    }
 
-        if (!q.prepare(QStringLiteral("UPDATE system SET value = ? WHERE key = 'schema_version'"))) {
-            fatalError("Failed to prepare database query", q.lastError());
+    const QStringList triggers({
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_insert AFTER INSERT ON records "
+                                                  "BEGIN UPDATE activities SET record_count = record_count + 1 WHERE id = NEW.activity; END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_delete AFTER DELETE ON records "
+                                                  "BEGIN UPDATE activities SET record_count = record_count - 1 WHERE id = OLD.activity; END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_update_activity AFTER UPDATE OF activity ON records WHEN OLD.activity <> NEW.activity "
+                                                  "BEGIN "
+                                                  "UPDATE activities SET record_count = record_count - 1 WHERE id = OLD.activity; "
+                                                  "UPDATE activities SET record_count = record_count + 1 WHERE id = NEW.activity; "
+                                                  "END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_activities_insert AFTER INSERT ON activities "
+                                                  "BEGIN UPDATE categories SET activity_count = activity_count + 1 WHERE id = NEW.category; END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_activities_delete AFTER DELETE ON activities "
+                                                  "BEGIN UPDATE categories SET activity_count = activity_count - 1 WHERE id = OLD.category; END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_activities_update_category AFTER UPDATE OF category ON activities WHEN OLD.category <> NEW.category "
+                                                  "BEGIN "
+                                                  "UPDATE categories SET activity_count = activity_count - 1 WHERE id = OLD.category; "
+                                                  "UPDATE categories SET activity_count = activity_count + 1 WHERE id = NEW.category; "
+                                                  "END")
+                               });
+
+    for (const QString &trigger : triggers) {
+        if (!q.exec(trigger)) {
+            fatalError("Failed to create trigger", q.lastError());
+            return false;
         }
+    }
 
-        q.addBindValue(DB_SCHEMA_VERSION);
+    return true;
+}
 
-        if (!q.exec()) {
-            fatalError("Failed to execute database query", q.lastError());
+
+
+/*!
+ * \brief Upgrade database schema to version 4.
+ *
+ * Adds partial indexes on the finished records matching the sort orders of the RecordsModel, each one
+ * also as a variant prefixed by the activity for the activity filter, and a partial index on the single
+ * active record that is loaded by the RecordsController.
+ */
+bool DBManager::updateToSchemaV4(QSqlQuery &q)
+{
+    qDebug("Update database to schema version 4");
+
+    const QStringList indexes({
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_start ON records (start, id) WHERE end > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_duration ON records (duration, id) WHERE end > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_repetitions ON records (repetitions, id) WHERE end > 0 AND repetitions > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_distance ON records (distance, id) WHERE end > 0 AND distance > 0.0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_activity_start ON records (activity, start, id) WHERE end > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_activity_duration ON records (activity, duration, id) WHERE end > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_activity_repetitions ON records (activity, repetitions, id) WHERE end > 0 AND repetitions > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_activity_distance ON records (activity, distance, id) WHERE end > 0 AND distance > 0.0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_active ON records (id) WHERE end = 0")
+                              });
+
+    for (const QString &index : indexes) {
+        if (!q.exec(index)) {
+            fatalError("Failed to create index", q.lastError());
+            return false;
         }
+    }
 
+    if (!q.exec(QStringLiteral("ANALYZE"))) {
+        fatalError("Failed to analyze database", q.lastError());
+        return false;
     }
 
     return true;
@@ -211,63 +585,253 @@ bool DBManager::updateDatabase()
 
 
 /*!
- * \brief Upgrade database schema to version 2.
+ * \brief Upgrade database schema to version 5.
+ *
+ * Adds the records_search full-text index over the record notes and the names of their activities
+ * and categories. The index uses the record ID as rowid and is kept in sync by triggers. If the SQLite
+ * library has been built without FTS5, FTS4 is used, both support the prefix queries of the RecordsModel.
  */
-bool DBManager::updateToSchemaV2()
+bool DBManager::updateToSchemaV5(QSqlQuery &q)
 {
-    qDebug("Update database to schema version 2");
+    qDebug("Update database to schema version 5");
 
-    QSqlQuery q(m_db);
+    if (!q.exec(QStringLiteral("CREATE VIRTUAL TABLE IF NOT EXISTS records_search USING fts5(note, activity, category, tokenize = 'unicode61 remove_diacritics 1')"))) {
+        qWarning("FTS5 is not available, falling back to FTS4: %s", qUtf8Printable(q.lastError().text()));
+        if (!q.exec(QStringLiteral("CREATE VIRTUAL TABLE IF NOT EXISTS records_search USING fts4(note, activity, category, tokenize=unicode61 \"remove_diacritics=1\")"))) {
+            fatalError("Failed to create table records_search", q.lastError());
+            return false;
+        }
+    }
 
-    if (!m_db.transaction()) {
-        fatalError("Failed to create database transaction", m_db.lastError());
+    if (!updateInChunks(q, 5, QStringLiteral("records"), QStringLiteral("INSERT INTO records_search (rowid, note, activity, category) "
+                                                                        "SELECT id, note, "
+                                                                        "(SELECT name FROM activities WHERE id = records.activity), "
+                                                                        "(SELECT c.name FROM activities a JOIN categories c ON c.id = a.category WHERE a.id = records.activity) "
+                                                                        "FROM records"))) {
+        fatalError("Failed to fill the search index", q.lastError());
         return false;
     }
 
-    if(!q.exec(QStringLiteral("CREATE TABLE IF NOT EXISTS system "
-                              "(id INTEGER PRIMARY KEY NOT NULL, "
-                              "key TEXT NOT NULL, "
-                              "value TEXT NOT NULL)"
-                              ))) {
-        fatalError("Failed to create system table", q.lastError());
-        return false;
+    const QString insert = QStringLiteral("INSERT INTO records_search (rowid, note, activity, category) "
+                                          "SELECT NEW.id, NEW.note, a.name, c.name FROM activities a JOIN categories c ON c.id = a.category WHERE a.id = NEW.activity; ");
+
+    const QStringList triggers({
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_search_insert AFTER INSERT ON records "
+                                                  "BEGIN ") % insert % QStringLiteral("END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_search_delete AFTER DELETE ON records "
+                                                  "BEGIN DELETE FROM records_search WHERE rowid = OLD.id; END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_records_search_update AFTER UPDATE OF note, activity ON records "
+                                                  "WHEN OLD.note IS NOT NEW.note OR OLD.activity <> NEW.activity "
+                                                  "BEGIN DELETE FROM records_search WHERE rowid = OLD.id; ") % insert % QStringLiteral("END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_activities_search_update AFTER UPDATE OF name, category ON activities "
+                                                  "WHEN OLD.name <> NEW.name OR OLD.category <> NEW.category "
+                                                  "BEGIN UPDATE records_search SET activity = NEW.name, category = (SELECT name FROM categories WHERE id = NEW.category) "
+                                                  "WHERE rowid IN (SELECT id FROM records WHERE activity = NEW.id); END"),
+                                   QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_categories_search_update AFTER UPDATE OF name ON categories "
+                                                  "WHEN OLD.name <> NEW.name "
+                                                  "BEGIN UPDATE records_search SET category = NEW.name "
+                                                  "WHERE rowid IN (SELECT r.id FROM records r JOIN activities a ON a.id = r.activity WHERE a.category = NEW.id); END")
+                               });
+
+    for (const QString &trigger : triggers) {
+        if (!q.exec(trigger)) {
+            fatalError("Failed to create trigger", q.lastError());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Upgrade database schema to version 6.
+ *
+ * Adds the daily, weekly and monthly rollup tables of the finished records together with the triggers
+ * that keep them up to date and fills them from the existing records. See Rollups for details.
+ */
+bool DBManager::updateToSchemaV6(QSqlQuery &q)
+{
+    qDebug("Update database to schema version 6");
+
+    const QStringList statements = Rollups::schema();
+
+    for (const QString &statement : statements) {
+        if (!q.exec(statement)) {
+            fatalError("Failed to create the statistics rollups", q.lastError());
+            return false;
+        }
     }
 
-    if (!q.prepare(QStringLiteral("INSERT INTO system (key, value) VALUES (?, ?)"))) {
-        fatalError("Failed to prepare database query", q.lastError());
+    if (!Rollups::rebuild(q)) {
+        fatalError("Failed to fill the statistics rollups", q.lastError());
         return false;
     }
 
-    q.addBindValue(QStringLiteral("schema_version"));
-    q.addBindValue(QStringLiteral("2"));
+    return true;
+}
+
+
+/*!
+ * \brief Adds the personal bests table and calculates the bests of the existing records.
+ */
+bool DBManager::updateToSchemaV7(QSqlQuery &q)
+{
+    qDebug("Update database to schema version 7");
 
-    if (!q.exec()) {
-        fatalError("Failed to execute database query", q.lastError());
+    const QStringList statements = PersonalBests::schema();
+
+    for (const QString &statement : statements) {
+        if (!q.exec(statement)) {
+            fatalError("Failed to create the personal bests table", q.lastError());
+            return false;
+        }
+    }
+
+    if (!PersonalBests::rebuild(q)) {
+        fatalError("Failed to calculate the personal bests", q.lastError());
         return false;
     }
 
-    if (!q.exec(QStringLiteral("ALTER TABLE activities ADD COLUMN sensor INTEGER DEFAULT 0"))) {
-        fatalError("Failed to add column sensor to table activities", q.lastError());
+    return true;
+}
+
+
+/*!
+ * \brief Upgrade database schema to version 8.
+ *
+ * Adds a covering partial index on the finished records for the statistics queries of the
+ * ActivityStatisticsModel and an index on the category names for the CategoriesModel.
+ */
+bool DBManager::updateToSchemaV8(QSqlQuery &q)
+{
+    qDebug("Update database to schema version 8");
+
+    const QStringList indexes({
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_records_finished_statistics ON records (activity, start, duration, repetitions, distance, tpr, avgSpeed, maxSpeed, end) WHERE end > 0"),
+                                  QStringLiteral("CREATE INDEX IF NOT EXISTS idx_categories_name ON categories (name)")
+                              });
+
+    for (const QString &index : indexes) {
+        if (!q.exec(index)) {
+            fatalError("Failed to create index", q.lastError());
+            return false;
+        }
+    }
+
+    if (!q.exec(QStringLiteral("ANALYZE"))) {
+        fatalError("Failed to analyze database", q.lastError());
         return false;
     }
 
-    if (!q.exec(QStringLiteral("ALTER TABLE activities ADD COLUMN sensorDelay INTEGER DEFAULT 0"))) {
-        fatalError("Failed to add column sensorDelay to table activities", q.lastError());
+    return true;
+}
+
+
+
+
+/*!
+ * \brief Returns the currently set pragma profile.
+ */
+DBManager::PragmaProfile DBManager::pragmaProfile()
+{
+    QMutexLocker locker(&s_pragmaMutex);
+    return s_pragmaProfile;
+}
+
+
+
+/*!
+ * \brief Sets the pragma \c profile used for new database connections.
+ *
+ * Should be set before the first database connection is opened.
+ */
+void DBManager::setPragmaProfile(const PragmaProfile &profile)
+{
+    QMutexLocker locker(&s_pragmaMutex);
+    s_pragmaProfile = profile;
+}
+
+
+
+/*!
+ * \brief Applies the pragma profile and enables foreign keys support on the open database connection \c db.
+ *
+ * Returns false if one of the pragmas could not be set.
+ */
+bool DBManager::applyPragmas(QSqlDatabase &db)
+{
+    const PragmaProfile p = pragmaProfile();
+
+    const QStringList pragmas({
+                                  QStringLiteral("PRAGMA foreign_keys = ON"),
+                                  QStringLiteral("PRAGMA journal_mode = %1").arg(p.journalMode),
+                                  QStringLiteral("PRAGMA synchronous = %1").arg(p.synchronous),
+                                  QStringLiteral("PRAGMA cache_size = %1").arg(p.cacheSize),
+                                  QStringLiteral("PRAGMA mmap_size = %1").arg(p.mmapSize),
+                                  QStringLiteral("PRAGMA temp_store = %1").arg(p.tempStore)
+                              });
+
+    bool ok = true;
+
+    QSqlQuery q(db);
+
+    for (const QString &pragma : pragmas) {
+        if (!q.exec(pragma)) {
+            qWarning("Failed to execute \"%s\": %s", qUtf8Printable(pragma), qUtf8Printable(q.lastError().text()));
+            ok = false;
+        }
     }
 
-    if (!m_db.commit()) {
-        fatalError("Failed to commit database transaction", m_db.lastError());
+#ifdef QT_DEBUG
+    if (q.exec(QStringLiteral("PRAGMA journal_mode")) && q.next()) {
+        qDebug() << "Journal mode of connection" << db.connectionName() << "is" << q.value(0).toString();
+    }
+#endif
+
+    return ok;
+}
+
+
+
+/*!
+ * \brief Runs a WAL checkpoint on the open database connection \c db.
+ *
+ * \c mode can be \a PASSIVE, \a FULL, \a RESTART or \a TRUNCATE. Returns false if the checkpoint
+ * could not be run or if it could not be completed because of other connections.
+ */
+bool DBManager::checkpoint(QSqlDatabase &db, const QString &mode)
+{
+    QSqlQuery q(db);
+
+    if (!q.exec(QStringLiteral("PRAGMA wal_checkpoint(%1)").arg(mode))) {
+        qWarning("Failed to run WAL checkpoint: %s", qUtf8Printable(q.lastError().text()));
         return false;
     }
 
+    // result row is busy, log frames, checkpointed frames
+    if (q.next()) {
+#ifdef QT_DEBUG
+        qDebug() << "WAL checkpoint" << mode << "on" << db.connectionName() << "busy:" << q.value(0).toInt() << "log:" << q.value(1).toInt() << "checkpointed:" << q.value(2).toInt();
+#endif
+        return (q.value(0).toInt() == 0);
+    }
+
     return true;
 }
 
 
+
 /*!
  * \brief Report a fatal error to the stderr output and abort the application.
+ *
+ * While upgrading a restored database via upgrade(), the error is only reported as a warning.
  */
 void DBManager::fatalError(const char *message, const QSqlError &error)
 {
-    qFatal("%s: %s", message, error.text().toLocal8Bit().constData());
+    if (m_fatal) {
+        qFatal("%s: %s", message, error.text().toLocal8Bit().constData());
+    } else {
+        qWarning("%s: %s", message, qUtf8Printable(error.text()));
+    }
 }
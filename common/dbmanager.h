@@ -23,13 +23,22 @@
 #include <QObject>
 #include <QThread>
 #include <QSqlDatabase>
+#include <QVector>
+#include <functional>
 
 class QSqlError;
+class QSqlQuery;
 
 namespace Gibrievida {
 
 /*!
  * \brief Manages the initialization of the local SQLite database.
+ *
+ * Database consumers should not access the database before the schema check has been finished.
+ * Use whenReady() to defer the initial loading until the ready() signal has been emitted.
+ *
+ * DBManager also holds the pragma profile that is applied to every database connection
+ * via applyPragmas(), so all connections use the same journal mode and cache settings.
  */
 class DBManager : public QThread
 {
@@ -38,16 +47,78 @@ public:
     explicit DBManager(QObject *parent = nullptr);
     ~DBManager();
 
+    /*!
+     * \brief SQLite pragma settings applied to every database connection.
+     */
+    struct PragmaProfile {
+        QString journalMode;    /*!< Journal mode, default is \a WAL. */
+        QString synchronous;    /*!< Synchronous mode, default is \a NORMAL. */
+        int cacheSize;          /*!< Page cache size, negative values are KiB, default is \a -8192. */
+        qint64 mmapSize;        /*!< Maximum size of memory mapped I/O in bytes, default is \a 67108864. */
+        QString tempStore;      /*!< Storage of temporary tables and indices, default is \a MEMORY. */
+    };
+
+    static PragmaProfile pragmaProfile();
+    static void setPragmaProfile(const PragmaProfile &profile);
+    static bool applyPragmas(QSqlDatabase &db);
+    static bool checkpoint(QSqlDatabase &db, const QString &mode = QStringLiteral("PASSIVE"));
+
+    static bool upgrade(const QString &databasePath);
+
+    static bool isReady();
+    static void whenReady(QObject *context, const std::function<void()> &func);
+
+signals:
+    /*!
+     * \brief This signal is emitted when the database schema is current and the database can be used.
+     */
+    void ready();
+    /*!
+     * \brief This signal is emitted before the schema is upgraded from version \a from to version \a to.
+     */
+    void migrationStarted(int from, int to);
+    /*!
+     * \brief This signal is emitted while the migration step to schema \a version is running.
+     *
+     * \a percent is the progress of the step in percent.
+     */
+    void migrationProgress(int version, int percent);
+    /*!
+     * \brief This signal is emitted after the schema has been upgraded to \a version.
+     */
+    void migrationFinished(int version);
+
 protected:
     void run() Q_DECL_OVERRIDE;
 
 private:
-    bool createDatabase();
-    bool updateDatabase();
-    bool updateToSchemaV2();
+    /*!
+     * \brief A single step of the schema migration.
+     */
+    struct Migration {
+        int version;                                /*!< Schema version after this step. */
+        bool (DBManager::*apply)(QSqlQuery &q);     /*!< Function executing the step. */
+    };
+
+    static const QVector<Migration> &migrations();
+    void initDatabase();
+    void setReady();
+    int schemaVersion();
+    bool migrate();
+    bool updateInChunks(QSqlQuery &q, int version, const QString &table, const QString &statement);
+
+    bool updateToSchemaV1(QSqlQuery &q);
+    bool updateToSchemaV2(QSqlQuery &q);
+    bool updateToSchemaV3(QSqlQuery &q);
+    bool updateToSchemaV4(QSqlQuery &q);
+    bool updateToSchemaV5(QSqlQuery &q);
+    bool updateToSchemaV6(QSqlQuery &q);
+    bool updateToSchemaV7(QSqlQuery &q);
+    bool updateToSchemaV8(QSqlQuery &q);
 
     void fatalError(const char *message, const QSqlError &error);
     QSqlDatabase m_db;
+    bool m_fatal;
 
     Q_DISABLE_COPY(DBManager)
 };
@@ -18,11 +18,6 @@
 */
 
 #include "dbmodel.h"
-#include <QStandardPaths>
-#include <QSqlError>
-#include <QSqlQuery>
-#include <QCoreApplication>
-#include <QStringBuilder>
 #ifdef QT_DEBUG
 #include <QtDebug>
 #endif
@@ -36,8 +31,12 @@ using namespace Gibrievida;
  */
 DBModel::DBModel(QObject *parent) : QAbstractListModel(parent)
 {
-    m_db = QSqlDatabase::database();
     m_inOperation = false;
+    m_requestId = 0;
+
+    DBWorker *worker = DBWorker::instance();
+    connect(worker, &DBWorker::finished, this, &DBModel::workerFinished);
+    connect(worker, &DBWorker::failed, this, &DBModel::workerFailed);
 }
 
 
@@ -88,48 +87,85 @@ void DBModel::setInOperation(bool inOperation)
 
 
 /*!
- * \brief Establish database connection.
+ * \brief Executes \c query with the \c bindValues on the DBWorker thread.
  *
- * Returns true if the database connection has been established successfull, otherwise returns false.
+ * A query that is still running for this model will be canceled. The model will be \link DBModel::inOperation inOperation \endlink
+ * until the result has been delivered to queryFinished() or the query has failed. Returns the ID of the request.
+ */
+int DBModel::startQuery(const QString &query, const QVariantList &bindValues)
+{
+    cancelQuery();
+
+    setInOperation(true);
+
+    m_requestId = DBWorker::instance()->enqueue(query, bindValues);
+
+    return m_requestId;
+}
+
+
+/*!
+ * \brief Cancels the currently running query of this model, if any.
  */
-bool DBModel::connectDb()
+void DBModel::cancelQuery()
 {
-    if (m_db.isValid() && m_db.isOpen()) {
-        return true;
+    if (m_requestId > 0) {
+        DBWorker::instance()->cancel(m_requestId);
+        m_requestId = 0;
+        setInOperation(false);
     }
+}
+
+
+/*!
+ * \brief Returns true while a query started by startQuery() is running.
+ */
+bool DBModel::isQueryRunning() const
+{
+    return (m_requestId > 0);
+}
 
-    if (!m_db.isValid()) {
 
-        const QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+/*!
+ * \brief Will be called with the result \c rows of the last query started by startQuery().
+ *
+ * Reimplement this in the derived models to populate the model data. The default implementation does nothing.
+ */
+void DBModel::queryFinished(const DBRows &rows)
+{
+    Q_UNUSED(rows)
+}
 
-        if (dirs.isEmpty()) {
-            return false;
-        }
 
-        const QString dbPath = dirs.first() % QLatin1Char('/') % QCoreApplication::instance()->applicationName() % QStringLiteral("/database.sqlite");
+/*!
+ * \brief Receives the results of the DBWorker and forwards the rows of the current request to queryFinished().
+ */
+void DBModel::workerFinished(int requestId, const DBRows &rows)
+{
+    if (requestId != m_requestId) {
+        return;
+    }
 
-        m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"));
-        m_db.setDatabaseName(dbPath);
+    m_requestId = 0;
 
-        if (m_db.open()) {
-            QSqlQuery q(m_db);
-            q.exec(QStringLiteral("PRAGMA foreign_keys = ON"));
-            return true;
-        } else {
-            return false;
-        }
+    queryFinished(rows);
 
-    } else if (!m_db.isOpen()) {
+    if (m_requestId == 0) {
+        setInOperation(false);
+    }
+}
 
-        if (m_db.open()) {
-            QSqlQuery q(m_db);
-            q.exec(QStringLiteral("PRAGMA foreign_keys = ON"));
-            return true;
-        } else {
-            return false;
-        }
 
+/*!
+ * \brief Resets the operation state if the current request of this model failed.
+ */
+void DBModel::workerFailed(int requestId)
+{
+    if (requestId != m_requestId) {
+        return;
     }
 
-    return false;
+    m_requestId = 0;
+
+    setInOperation(false);
 }
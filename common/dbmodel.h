@@ -22,14 +22,16 @@
 
 #include <QObject>
 #include <QAbstractListModel>
-#include <QSqlDatabase>
+#include "dbworker.h"
 
 namespace Gibrievida {
 
 /*!
  * \brief Base model class for all database models.
  *
- * This class provides methods to connect to the SQL database as well as indicating busy models.
+ * This class provides methods to load data from the SQL database as well as indicating busy models.
+ * Model data should be loaded via startQuery(), that executes the query on the DBWorker thread and
+ * delivers the result rows to queryFinished(). While a query is running, the model is \link DBModel::inOperation inOperation \endlink.
  */
 class DBModel : public QAbstractListModel
 {
@@ -42,16 +44,24 @@ public:
     bool isInOperation() const;
 
 protected:
-    bool connectDb();
-    QSqlDatabase m_db;
     void setInOperation(bool inOperation);
 
+    int startQuery(const QString &query, const QVariantList &bindValues = QVariantList());
+    void cancelQuery();
+    bool isQueryRunning() const;
+    virtual void queryFinished(const DBRows &rows);
+
 signals:
     void inOperationChanged(bool inOperation);
 
+private slots:
+    void workerFinished(int requestId, const Gibrievida::DBRows &rows);
+    void workerFailed(int requestId);
+
 private:
     Q_DISABLE_COPY(DBModel)
     bool m_inOperation;
+    int m_requestId;
 };
 
 }
@@ -0,0 +1,283 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dbworker.h"
+#include <QThread>
+#include <QCoreApplication>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QMutexLocker>
+#include <QTimer>
+#include "globals.h"
+#include "dbmanager.h"
+#include "statementcache.h"
+#include "connectionpool.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+static DBWorker *s_instance = nullptr;
+
+/*!
+ * \brief Constructs a new database worker.
+ *
+ * Use instance() to get the worker object.
+ */
+DBWorker::DBWorker(QObject *parent) : QObject(parent)
+{
+    m_thread = nullptr;
+    m_checkpointTimer = new QTimer(this);
+    m_checkpointTimer->setInterval(DB_CHECKPOINT_INTERVAL);
+    connect(m_checkpointTimer, &QTimer::timeout, this, &DBWorker::checkpoint);
+}
+
+
+/*!
+ * \brief Destroys the database worker.
+ */
+DBWorker::~DBWorker()
+{
+    s_instance = nullptr;
+}
+
+
+/*!
+ * \brief Returns the global database worker object.
+ *
+ * On first call, this will create the worker. Its thread will be started when the DBManager
+ * is ready, requests enqueued before will be executed then. The thread will be stopped
+ * when the application is about to quit. Has to be called from the GUI thread.
+ */
+DBWorker *DBWorker::instance()
+{
+    if (!s_instance) {
+
+        qRegisterMetaType<Gibrievida::DBRows>("Gibrievida::DBRows");
+
+        QThread *thread = new QThread;
+        thread->setObjectName(QStringLiteral("DBWorker"));
+
+        s_instance = new DBWorker;
+        s_instance->m_thread = thread;
+        s_instance->moveToThread(thread);
+
+        connect(thread, &QThread::started, s_instance->m_checkpointTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+        connect(thread, &QThread::finished, s_instance, &QObject::deleteLater);
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, thread, [thread] () {
+            thread->quit();
+            thread->wait();
+            thread->deleteLater();
+        });
+
+        // queued requests will be executed as soon as the thread is running
+        DBManager::whenReady(thread, [thread] () {
+            thread->start(QThread::LowPriority);
+        });
+    }
+
+    return s_instance;
+}
+
+
+/*!
+ * \brief Runs a passive WAL checkpoint on the connection of the worker.
+ *
+ * Called periodically from the worker thread, so the write-ahead log does not grow too much
+ * while other connections keep reading from the database.
+ */
+void DBWorker::checkpoint()
+{
+    QSqlDatabase db = ConnectionPool::database();
+
+    if (db.isOpen()) {
+        DBManager::checkpoint(db);
+    }
+}
+
+
+
+/*!
+ * \brief Replaces the database file by \a file.
+ *
+ * Closes the connection of the worker and replaces the database via ConnectionPool::replaceDatabase()
+ * in the worker thread. The calling thread is blocked until the database has been replaced, so no
+ * request can reopen the old database in between. Connections of other threads have to be closed
+ * before. The worker connection will be reopened on the next request. Returns true on success.
+ */
+bool DBWorker::replaceDatabase(const QString &file)
+{
+    if (m_thread && m_thread->isRunning() && QThread::currentThread() != m_thread) {
+        bool ok = false;
+        QMetaObject::invokeMethod(this, "swapDatabase", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ok), Q_ARG(QString, file));
+        return ok;
+    }
+
+    return swapDatabase(file);
+}
+
+
+/*!
+ * \brief Closes the worker connection and replaces the database by \a file.
+ */
+bool DBWorker::swapDatabase(const QString &file)
+{
+    ConnectionPool::close();
+    return ConnectionPool::replaceDatabase(file);
+}
+
+
+
+/*!
+ * \brief Adds a new \c query together with its \c bindValues to the queue of the worker thread.
+ *
+ * Returns the ID of the request that will be part of the finished() or failed() signals.
+ * This function is thread-safe.
+ */
+int DBWorker::enqueue(const QString &query, const QVariantList &bindValues)
+{
+    const int id = m_lastRequestId.fetchAndAddOrdered(1) + 1;
+
+    {
+        QMutexLocker locker(&m_canceledMutex);
+        m_pending.insert(id);
+    }
+
+    QMetaObject::invokeMethod(this, "execute", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QString, query), Q_ARG(QVariantList, bindValues));
+
+    return id;
+}
+
+
+/*!
+ * \brief Cancels the request identified by \c requestId.
+ *
+ * If the request has not been executed yet, it will be skipped. If it is currently executed,
+ * fetching the result will be aborted. No signal will be emitted for canceled requests. Requests
+ * that have already been completed are ignored. This function is thread-safe.
+ */
+void DBWorker::cancel(int requestId)
+{
+    if (requestId <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_canceledMutex);
+    if (m_pending.contains(requestId)) {
+        m_canceled.insert(requestId);
+    }
+}
+
+
+/*!
+ * \brief Returns true if the request identified by \c requestId has been canceled.
+ */
+bool DBWorker::isCanceled(int requestId)
+{
+    QMutexLocker locker(&m_canceledMutex);
+    return m_canceled.contains(requestId);
+}
+
+
+/*!
+ * \brief Removes the request identified by \c requestId from the pending and canceled requests.
+ *
+ * Has to be called once the request will not be executed any further. Returns true if the
+ * request has been canceled, no signal should be emitted for it then.
+ */
+bool DBWorker::complete(int requestId)
+{
+    QMutexLocker locker(&m_canceledMutex);
+    m_pending.remove(requestId);
+    return m_canceled.remove(requestId);
+}
+
+
+/*!
+ * \brief Executes the request identified by \c requestId in the worker thread.
+ */
+void DBWorker::execute(int requestId, const QString &query, const QVariantList &bindValues)
+{
+    if (isCanceled(requestId)) {
+        complete(requestId);
+        return;
+    }
+
+    const QSqlDatabase db = ConnectionPool::database();
+
+    if (!db.isOpen()) {
+        if (!complete(requestId)) {
+            emit failed(requestId);
+        }
+        return;
+    }
+
+    // the query itself is used as statement id, the cache keeps the most recently used query variants
+    QSqlQuery *q = StatementCache::prepare(db, query, query);
+
+    if (!q) {
+        if (!complete(requestId)) {
+            emit failed(requestId);
+        }
+        return;
+    }
+
+    for (const QVariant &value : bindValues) {
+        q->addBindValue(value);
+    }
+
+    if (!q->exec()) {
+        qWarning("Failed to execute database query: %s", qUtf8Printable(q->lastError().text()));
+        if (!complete(requestId)) {
+            emit failed(requestId);
+        }
+        return;
+    }
+
+    const int columns = q->record().count();
+
+    DBRows rows;
+
+    while (q->next()) {
+
+        // check from time to time if the request is still needed
+        if (((rows.size() + 1) % 256 == 0) && isCanceled(requestId)) {
+            q->finish();
+            complete(requestId);
+            return;
+        }
+
+        QVariantList row;
+        row.reserve(columns);
+        for (int i = 0; i < columns; ++i) {
+            row.append(q->value(i));
+        }
+        rows.append(row);
+    }
+
+    q->finish();
+
+    if (complete(requestId)) {
+        return;
+    }
+
+    emit finished(requestId, rows);
+}
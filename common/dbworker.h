@@ -0,0 +1,94 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DBWORKER_H
+#define DBWORKER_H
+
+#include <QObject>
+#include <QVariantList>
+#include <QVector>
+#include <QMutex>
+#include <QSet>
+
+class QThread;
+class QTimer;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Result rows of a query executed by the DBWorker.
+ *
+ * Every row contains the column values in the order of the query.
+ */
+typedef QVector<QVariantList> DBRows;
+
+/*!
+ * \brief Executes read queries on a dedicated database thread.
+ *
+ * The worker lives in its own thread and uses the connection of that thread from the ConnectionPool. Queries are
+ * added via enqueue() from any thread and the results are delivered as plain row data through
+ * the finished() signal, so that the models can create their items on the GUI thread. Requests
+ * that are not needed anymore can be canceled with cancel(). The worker also runs periodic passive
+ * WAL checkpoints.
+ */
+class DBWorker : public QObject
+{
+    Q_OBJECT
+public:
+    static DBWorker *instance();
+
+    int enqueue(const QString &query, const QVariantList &bindValues = QVariantList());
+    void cancel(int requestId);
+    bool replaceDatabase(const QString &file);
+
+signals:
+    /*!
+     * \brief Emitted if the request identified by \c requestId has been executed successfully.
+     */
+    void finished(int requestId, const Gibrievida::DBRows &rows);
+    /*!
+     * \brief Emitted if the request identified by \c requestId failed.
+     */
+    void failed(int requestId);
+
+private slots:
+    void execute(int requestId, const QString &query, const QVariantList &bindValues);
+    void checkpoint();
+    bool swapDatabase(const QString &file);
+
+private:
+    explicit DBWorker(QObject *parent = nullptr);
+    ~DBWorker();
+
+    bool isCanceled(int requestId);
+    bool complete(int requestId);
+
+    QThread *m_thread;
+    QTimer *m_checkpointTimer;
+    QMutex m_canceledMutex;
+    QSet<int> m_pending;
+    QSet<int> m_canceled;
+    QAtomicInt m_lastRequestId;
+
+    Q_DISABLE_COPY(DBWorker)
+};
+
+}
+
+#endif // DBWORKER_H
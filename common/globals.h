@@ -25,5 +25,21 @@
 #define START_SOUND_BASE_URL "/usr/share/harbour-gibrievida/sounds/start"
 #define SIGNALLOST_SOUND_BASE_URL "/usr/share/harbour-gibrievida/sounds/signallost"
 
+#define DB_SCHEMA_VERSION 8
+
+#define DB_PRAGMA_JOURNAL_MODE "WAL"
+#define DB_PRAGMA_SYNCHRONOUS "NORMAL"
+#define DB_PRAGMA_CACHE_SIZE -8192
+#define DB_PRAGMA_MMAP_SIZE 67108864
+#define DB_PRAGMA_TEMP_STORE "MEMORY"
+#define DB_CHECKPOINT_INTERVAL 120000
+#define STATEMENT_CACHE_SIZE 48
+#define RECORD_WRITER_FLUSH_INTERVAL 10000
+#define BACKUP_PAGES_PER_STEP 128
+#define BACKUP_BUSY_DELAY 50
+#define BACKUP_COMPRESSION_CHUNK_SIZE 65536
+#define BACKUP_COMPRESSION_LEVEL "wb6"
+#define BACKUP_MAX_DELTAS 7
+
 #endif // GLOBALS
 
@@ -0,0 +1,141 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "migrationstatus.h"
+#include "dbmanager.h"
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Constructs a new MigrationStatus that follows the migration of \a manager.
+ *
+ * Has to be constructed before the DBManager thread is started, otherwise the start of the
+ * migration might be missed.
+ */
+MigrationStatus::MigrationStatus(DBManager *manager, QObject *parent) : QObject(parent)
+{
+    connect(manager, &DBManager::migrationStarted, this, &MigrationStatus::started);
+    connect(manager, &DBManager::migrationProgress, this, &MigrationStatus::stepProgress);
+    connect(manager, &DBManager::migrationFinished, this, &MigrationStatus::finished);
+}
+
+
+/*!
+ * \brief Destroys the MigrationStatus object.
+ */
+MigrationStatus::~MigrationStatus()
+{
+
+}
+
+
+/*!
+ * \property MigrationStatus::running
+ * \brief Returns true while the database schema is migrated.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>bool</TD><TD>isRunning() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>runningChanged(bool running)</TD></TR></TABLE>
+ */
+
+/*!
+ * \fn void MigrationStatus::runningChanged(bool running)
+ * \brief Part of the \link MigrationStatus::running running \endlink property.
+ */
+
+/*!
+ * \brief Part of the \link MigrationStatus::running running \endlink property.
+ */
+bool MigrationStatus::isRunning() const { return m_running; }
+
+void MigrationStatus::setRunning(bool running)
+{
+    if (running != m_running) {
+        m_running = running;
+        emit runningChanged(isRunning());
+    }
+}
+
+
+/*!
+ * \property MigrationStatus::progress
+ * \brief The progress of the whole migration in percent.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>progress() const</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>progressChanged(int progress)</TD></TR></TABLE>
+ */
+
+/*!
+ * \fn void MigrationStatus::progressChanged(int progress)
+ * \brief Part of the \link MigrationStatus::progress progress \endlink property.
+ */
+
+/*!
+ * \brief Part of the \link MigrationStatus::progress progress \endlink property.
+ */
+int MigrationStatus::progress() const { return m_progress; }
+
+void MigrationStatus::setProgress(int progress)
+{
+    if (progress != m_progress) {
+        m_progress = progress;
+        emit progressChanged(this->progress());
+    }
+}
+
+
+/*!
+ * \brief Starts following a migration from schema version \a from to \a to.
+ */
+void MigrationStatus::started(int from, int to)
+{
+    m_from = from;
+    m_to = to;
+    setProgress(0);
+    setRunning(true);
+}
+
+
+/*!
+ * \brief Maps the \a percent of the migration step to \a version onto the progress of the whole migration.
+ */
+void MigrationStatus::stepProgress(int version, int percent)
+{
+    const int steps = m_to - m_from;
+
+    if (steps <= 0) {
+        return;
+    }
+
+    setProgress(((version - m_from - 1) * 100 + percent) / steps);
+}
+
+
+/*!
+ * \brief Ends following the migration, that has reached schema \a version.
+ */
+void MigrationStatus::finished(int version)
+{
+    Q_UNUSED(version)
+    setProgress(100);
+    setRunning(false);
+}
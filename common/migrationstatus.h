@@ -0,0 +1,71 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIGRATIONSTATUS_H
+#define MIGRATIONSTATUS_H
+
+#include <QObject>
+
+namespace Gibrievida {
+
+class DBManager;
+
+/*!
+ * \brief Shows the progress of a running schema migration in the user interface.
+ *
+ * Lives in the GUI thread and follows the migration signals of the DBManager, that are delivered
+ * queued from the migration thread. The progress covers all migration steps between the old and the
+ * new schema version.
+ */
+class MigrationStatus : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(int progress READ progress NOTIFY progressChanged)
+public:
+    explicit MigrationStatus(DBManager *manager, QObject *parent = nullptr);
+    ~MigrationStatus();
+
+    bool isRunning() const;
+    int progress() const;
+
+signals:
+    void runningChanged(bool running);
+    void progressChanged(int progress);
+
+private slots:
+    void started(int from, int to);
+    void stepProgress(int version, int percent);
+    void finished(int version);
+
+private:
+    Q_DISABLE_COPY(MigrationStatus)
+
+    void setRunning(bool running);
+    void setProgress(int progress);
+
+    bool m_running = false;
+    int m_progress = 0;
+    int m_from = 0;
+    int m_to = 0;
+};
+
+}
+
+#endif // MIGRATIONSTATUS_H
@@ -0,0 +1,274 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "personalbests.h"
+#include "record.h"
+#include "activity.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QStringBuilder>
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+static const PersonalBests::Metric personalBestMetrics[] = {PersonalBests::Distance, PersonalBests::Repetitions, PersonalBests::Tpr, PersonalBests::Speed};
+
+/*!
+ * \brief Returns the column of the records table that contains the value of \a metric.
+ */
+QString PersonalBests::column(Metric metric)
+{
+    switch (metric) {
+    case Repetitions:
+        return QStringLiteral("repetitions");
+    case Tpr:
+        return QStringLiteral("tpr");
+    case Speed:
+        return QStringLiteral("maxSpeed");
+    default:
+        return QStringLiteral("distance");
+    }
+}
+
+
+/*!
+ * \brief Returns the statements that create the personal bests table.
+ *
+ * The rows of an activity are removed together with the activity.
+ */
+QStringList PersonalBests::schema()
+{
+    QStringList statements;
+
+    statements << QStringLiteral("CREATE TABLE IF NOT EXISTS personal_bests "
+                                 "(activity INTEGER NOT NULL, "
+                                 "metric INTEGER NOT NULL, "
+                                 "record INTEGER NOT NULL, "
+                                 "value REAL NOT NULL, "
+                                 "PRIMARY KEY (activity, metric), "
+                                 "FOREIGN KEY(activity) REFERENCES activities(id) ON DELETE CASCADE) WITHOUT ROWID");
+
+    return statements;
+}
+
+
+/*!
+ * \brief Recreates the content of the personal bests table from the records table.
+ *
+ * Should be executed inside a transaction. Returns false if one of the statements failed.
+ */
+bool PersonalBests::rebuild(QSqlQuery &q)
+{
+    if (!q.exec(QStringLiteral("SELECT id FROM activities"))) {
+        qWarning("Failed to query the activities: %s", qUtf8Printable(q.lastError().text()));
+        return false;
+    }
+
+    QList<int> activityIds;
+    while (q.next()) {
+        activityIds << q.value(0).toInt();
+    }
+
+    for (int activityId : activityIds) {
+        if (!recompute(q, activityId)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Recalculates the personal bests of the activity identified by \a activityId from its finished records.
+ *
+ * Used after records have been updated or removed, because a removed best can not be replaced without
+ * looking at the remaining records. If several records have the same best value, the oldest one holds it.
+ */
+bool PersonalBests::recompute(QSqlQuery &q, int activityId)
+{
+    q.prepare(QStringLiteral("DELETE FROM personal_bests WHERE activity = ?"));
+    q.addBindValue(activityId);
+
+    if (!q.exec()) {
+        qWarning("Failed to clear the personal bests of activity %i: %s", activityId, qUtf8Printable(q.lastError().text()));
+        return false;
+    }
+
+    for (Metric metric : personalBestMetrics) {
+
+        const QString col = column(metric);
+
+        q.prepare(QStringLiteral("INSERT INTO personal_bests (activity, metric, record, value) "
+                                 "SELECT activity, %1, id, %2 FROM records WHERE activity = ? AND end > 0 AND %2 > 0 "
+                                 "ORDER BY %2 %3, id ASC LIMIT 1").arg(QString::number(static_cast<int>(metric)), col, (metric == Tpr) ? QStringLiteral("ASC") : QStringLiteral("DESC")));
+        q.addBindValue(activityId);
+
+        if (!q.exec()) {
+            qWarning("Failed to calculate the personal best %s of activity %i: %s", qUtf8Printable(col), activityId, qUtf8Printable(q.lastError().text()));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Loads the personal bests of the Activity \a a from the database into the object.
+ */
+bool PersonalBests::load(QSqlQuery &q, Activity *a)
+{
+    if (!a || !a->isValid()) {
+        return false;
+    }
+
+    q.prepare(QStringLiteral("SELECT metric, value FROM personal_bests WHERE activity = ?"));
+    q.addBindValue(a->databaseId());
+
+    if (!q.exec()) {
+        qWarning("Failed to load the personal bests of activity %i: %s", a->databaseId(), qUtf8Printable(q.lastError().text()));
+        return false;
+    }
+
+    double distance = 0.0;
+    int repetitions = 0;
+    float tpr = 0.0f;
+    float speed = 0.0f;
+
+    while (q.next()) {
+        switch (q.value(0).toInt()) {
+        case Distance:
+            distance = q.value(1).toDouble();
+            break;
+        case Repetitions:
+            repetitions = q.value(1).toInt();
+            break;
+        case Tpr:
+            tpr = q.value(1).toFloat();
+            break;
+        case Speed:
+            speed = q.value(1).toFloat();
+            break;
+        default:
+            break;
+        }
+    }
+
+    a->setPersonalBests(distance, repetitions, tpr, speed);
+
+    return true;
+}
+
+
+/*!
+ * \brief Writes a single personal best.
+ */
+bool PersonalBests::store(QSqlQuery &q, int activityId, Metric metric, int recordId, double value)
+{
+    q.prepare(QStringLiteral("INSERT OR REPLACE INTO personal_bests (activity, metric, record, value) VALUES (?, ?, ?, ?)"));
+    q.addBindValue(activityId);
+    q.addBindValue(static_cast<int>(metric));
+    q.addBindValue(recordId);
+    q.addBindValue(value);
+
+    if (!q.exec()) {
+        qWarning("Failed to store the personal best %s of activity %i: %s", qUtf8Printable(column(metric)), activityId, qUtf8Printable(q.lastError().text()));
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Compares the finished Record \a r with the personal bests of its Activity \a a and stores the new bests.
+ *
+ * The personal bests of \a a have to be loaded, the comparison does not read the records table. Only
+ * metrics that \a r has improved are written to the database and to \a a. If \a flags is not null, it
+ * is set to a combination of Record::PersonalBest flags for the stored bests.
+ *
+ * Returns false if a new best could not be stored, \a a is unchanged in that case and the current
+ * transaction has to be rolled back.
+ */
+bool PersonalBests::update(QSqlQuery &q, Record *r, Activity *a, int *flags)
+{
+    if (flags) {
+        *flags = Record::NoPersonalBest;
+    }
+
+    if (!r || !a || !a->isValid()) {
+        return false;
+    }
+
+    int newBests = Record::NoPersonalBest;
+
+    double distance = a->bestDistance();
+    int repetitions = a->bestRepetitions();
+    float tpr = a->bestTpr();
+    float speed = a->bestSpeed();
+
+    if (r->distance() > distance) {
+        if (!store(q, a->databaseId(), Distance, r->databaseId(), r->distance())) {
+            return false;
+        }
+        distance = r->distance();
+        newBests |= Record::DistancePersonalBest;
+    }
+
+    if (static_cast<int>(r->repetitions()) > repetitions) {
+        if (!store(q, a->databaseId(), Repetitions, r->databaseId(), r->repetitions())) {
+            return false;
+        }
+        repetitions = static_cast<int>(r->repetitions());
+        newBests |= Record::RepetitionsPersonalBest;
+    }
+
+    if (r->tpr() > 0.0f && (tpr <= 0.0f || r->tpr() < tpr)) {
+        if (!store(q, a->databaseId(), Tpr, r->databaseId(), r->tpr())) {
+            return false;
+        }
+        tpr = r->tpr();
+        newBests |= Record::TprPersonalBest;
+    }
+
+    if (r->maxSpeed() > speed) {
+        if (!store(q, a->databaseId(), Speed, r->databaseId(), r->maxSpeed())) {
+            return false;
+        }
+        speed = r->maxSpeed();
+        newBests |= Record::SpeedPersonalBest;
+    }
+
+    if (newBests != Record::NoPersonalBest) {
+#ifdef QT_DEBUG
+        qDebug("Record %i set new personal bests %i for activity %i", r->databaseId(), newBests, a->databaseId());
+#endif
+        a->setPersonalBests(distance, repetitions, tpr, speed);
+    }
+
+    if (flags) {
+        *flags = newBests;
+    }
+
+    return true;
+}
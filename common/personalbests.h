@@ -0,0 +1,69 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERSONALBESTS_H
+#define PERSONALBESTS_H
+
+#include <QString>
+#include <QStringList>
+
+class QSqlQuery;
+
+namespace Gibrievida {
+
+class Record;
+class Activity;
+
+/*!
+ * \brief Maintains the personal bests table of the finished records.
+ *
+ * The table personal_bests contains one row per activity and metric with the best value and the
+ * record that set it. Finishing a record compares it against the bests of its Activity, that have
+ * been loaded before, and writes only the improved metrics. Updating or removing records recomputes
+ * the bests of the affected activities only.
+ */
+class PersonalBests
+{
+public:
+    /*!
+     * \brief The metrics that have a personal best.
+     */
+    enum Metric {
+        Distance = 0,   /**< Longest distance. */
+        Repetitions,    /**< Most repetitions. */
+        Tpr,            /**< Lowest time per repetition. */
+        Speed           /**< Top speed. */
+    };
+
+    static QStringList schema();
+    static bool rebuild(QSqlQuery &q);
+    static bool recompute(QSqlQuery &q, int activityId);
+    static bool load(QSqlQuery &q, Activity *a);
+    static bool update(QSqlQuery &q, Record *r, Activity *a, int *flags = nullptr);
+
+private:
+    PersonalBests();
+
+    static QString column(Metric metric);
+    static bool store(QSqlQuery &q, int activityId, Metric metric, int recordId, double value);
+};
+
+}
+
+#endif // PERSONALBESTS_H
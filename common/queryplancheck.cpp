@@ -0,0 +1,160 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryplancheck.h"
+#include "recordsmodel.h"
+#include "recordscontroller.h"
+#include "activitiesmodel.h"
+#include "categoriesmodel.h"
+#include "activitystatisticsmodel.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QStringBuilder>
+#include <QVariant>
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Returns the queries to check.
+ */
+QVector<QueryPlanCheck::Query> QueryPlanCheck::queries()
+{
+    QVector<Query> list;
+
+    const QStringList columns = RecordsModel::sortColumns();
+    const bool directions[] = {true, false};
+    const bool flags[] = {false, true};
+
+    // no filter, activity filter and category filter
+    const int filters[][2] = {{0, 0}, {1, 0}, {0, 1}};
+
+    for (const QString &column : columns) {
+        for (bool descending : directions) {
+            for (const auto &filter : filters) {
+                for (bool search : flags) {
+                    for (bool afterCursor : flags) {
+                        const QString range = (afterCursor && !search) ? cursorRange(column, descending) : QString();
+                        list.append({RecordsModel::pageQuery(column, descending, filter[0], filter[1], search, afterCursor), search, range});
+                    }
+                }
+            }
+        }
+    }
+
+    list.append({RecordsController::activeRecordQuery(), false, QString()});
+    list.append({ActivitiesModel::loadQuery(), false, QString()});
+    list.append({CategoriesModel::loadQuery(), false, QString()});
+
+    for (const auto &filter : filters) {
+        for (bool windowed : flags) {
+            list.append({ActivityStatisticsModel::statisticsQuery(filter[0], filter[1], windowed), false, QString()});
+        }
+    }
+
+    return list;
+}
+
+
+/*!
+ * \brief Returns true if the query plan \a detail scans the records table without an index.
+ *
+ * The activities and categories tables are small and loaded completely, so scanning them is fine.
+ * Depending on the SQLite version, the detail is like \c "SCAN r" or \c "SCAN TABLE records AS r".
+ */
+bool QueryPlanCheck::isFullScan(const QString &detail)
+{
+    if (!detail.startsWith(QLatin1String("SCAN")) || detail.contains(QLatin1String("USING"))) {
+        return false;
+    }
+
+    const QStringList parts = detail.split(QLatin1Char(' '), QString::SkipEmptyParts);
+
+    return parts.contains(QStringLiteral("records")) || parts.contains(QStringLiteral("r"));
+}
+
+
+/*!
+ * \brief Returns the range constraint of the keyset cursor on the sort \a column as shown in the query plan.
+ */
+QString QueryPlanCheck::cursorRange(const QString &column, bool descending)
+{
+    return column.mid(column.indexOf(QLatin1Char('.')) + 1) % (descending ? QLatin1String("<?") : QLatin1String(">?"));
+}
+
+
+/*!
+ * \brief Runs EXPLAIN QUERY PLAN for every query on the connection \a db.
+ *
+ * Prints a warning for every query with an inefficient plan and returns the number of failed queries.
+ */
+int QueryPlanCheck::run(const QSqlDatabase &db)
+{
+    const QVector<Query> list = queries();
+
+    int failed = 0;
+
+    for (const Query &query : list) {
+
+        QSqlQuery q(db);
+
+        if (!q.prepare(QStringLiteral("EXPLAIN QUERY PLAN ") % query.sql)) {
+            qWarning("Failed to explain query: %s", qUtf8Printable(q.lastError().text()));
+            ++failed;
+            continue;
+        }
+
+        // the plan does not depend on the values
+        const int parameters = query.sql.count(QLatin1Char('?'));
+        for (int i = 0; i < parameters; ++i) {
+            q.addBindValue(1);
+        }
+
+        if (!q.exec()) {
+            qWarning("Failed to explain query: %s", qUtf8Printable(q.lastError().text()));
+            ++failed;
+            continue;
+        }
+
+        QStringList problems;
+        bool rangeFound = query.range.isEmpty();
+
+        while (q.next()) {
+            const QString detail = q.value(3).toString();
+            if (isFullScan(detail) || (!query.sortsMatches && detail.contains(QLatin1String("TEMP B-TREE")))) {
+                problems << detail;
+            }
+            rangeFound = rangeFound || detail.contains(query.range);
+        }
+
+        if (!rangeFound) {
+            problems << QStringLiteral("no %1 range on the sort index").arg(query.range);
+        }
+
+        if (!problems.isEmpty()) {
+            qWarning("Inefficient query plan \"%s\" for query: %s", qUtf8Printable(problems.join(QLatin1String("; "))), qUtf8Printable(query.sql));
+            ++failed;
+        }
+    }
+
+    qDebug("Checked the query plans of %i queries, %i failed.", list.size(), failed);
+
+    return failed;
+}
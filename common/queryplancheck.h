@@ -0,0 +1,67 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QUERYPLANCHECK_H
+#define QUERYPLANCHECK_H
+
+#include <QString>
+#include <QVector>
+
+class QSqlDatabase;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Checks the query plans of the queries the models and controllers issue.
+ *
+ * The queries are built by the same functions the models and controllers use, for every sort
+ * column, sort direction, filter and page of the RecordsModel. A query fails the check if its plan
+ * scans the records table without an index, or if it needs a temporary B-tree to sort. Only the
+ * search queries of the RecordsModel may sort, because they sort the matches of the search index.
+ * Pages after the keyset cursor also fail if the cursor is not used as range of the sort index.
+ *
+ * run() is executed on start up in debug builds and by starting the application with the
+ * \c --check-query-plans argument, that exits with a non-zero status if a check fails. The test in
+ * \c tests/queryplans runs it on a new database with and without planner statistics.
+ */
+class QueryPlanCheck
+{
+public:
+    static int run(const QSqlDatabase &db);
+
+private:
+    QueryPlanCheck();
+
+    /*!
+     * \brief A query to check.
+     */
+    struct Query {
+        QString sql;        /*!< The SQL of the query. */
+        bool sortsMatches;  /*!< True if the query may sort its result in a temporary B-tree. */
+        QString range;      /*!< Constraint the plan has to search the index with, like \c "start<?". */
+    };
+
+    static QVector<Query> queries();
+    static bool isFullScan(const QString &detail);
+    static QString cursorRange(const QString &column, bool descending);
+};
+
+}
+
+#endif // QUERYPLANCHECK_H
@@ -43,6 +43,7 @@ Record::Record(QObject *parent) :
     m_tpr = 0.0;
     m_maxSpeed = 0.0;
     m_avgSpeed = 0.0;
+    m_newPersonalBests = NoPersonalBest;
 
 #ifdef QT_DEBUG
     qDebug() << "Constructed a new empty" << this;
@@ -54,7 +55,7 @@ Record::Record(QObject *parent) :
  * \overload
  */
 Record::Record(int databaseId, const QDateTime &start, const QDateTime &end, uint duration, uint repetitions, double distance, const QString &note, float tpr, float maxSpeed, float avgSpeed, QObject *parent) :
-    QObject(parent), m_databaseId(databaseId), m_start(start), m_end(end), m_duration(duration), m_repetitions(repetitions), m_distance(distance), m_note(note), m_tpr(tpr), m_maxSpeed(maxSpeed), m_avgSpeed(avgSpeed)
+    QObject(parent), m_databaseId(databaseId), m_start(start), m_end(end), m_duration(duration), m_repetitions(repetitions), m_distance(distance), m_note(note), m_tpr(tpr), m_maxSpeed(maxSpeed), m_avgSpeed(avgSpeed), m_newPersonalBests(NoPersonalBest)
 {
     m_active = (end == QDateTime::fromTime_t(0));
 
@@ -521,6 +522,44 @@ void Record::setAvgSpeed(float nAvgSpeed)
 
 
 
+/*!
+ * \property Record::newPersonalBests
+ * \brief The personal bests of its activity this record has set when it has been finished.
+ *
+ * Combination of PersonalBest flags, set by the RecordsController when the record has been finished.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>int</TD><TD>newPersonalBests() const</TD></TR><TR><TD>void</TD><TD>setNewPersonalBests(int nNewPersonalBests)</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>newPersonalBestsChanged(int newPersonalBests)</TD></TR></TABLE>
+ */
+
+/*!
+ * \fn void Record::newPersonalBestsChanged(int newPersonalBests)
+ * \brief Part of the \link Record::newPersonalBests newPersonalBests \endlink property.
+ */
+
+/*!
+ * \brief Part of the \link Record::newPersonalBests newPersonalBests \endlink property.
+ */
+int Record::newPersonalBests() const { return m_newPersonalBests; }
+
+/*!
+ * \brief Part of the \link Record::newPersonalBests newPersonalBests \endlink property.
+ */
+void Record::setNewPersonalBests(int nNewPersonalBests)
+{
+    if (nNewPersonalBests != m_newPersonalBests) {
+        m_newPersonalBests = nNewPersonalBests;
+#ifdef QT_DEBUG
+        qDebug() << "Changed newPersonalBests to" << m_newPersonalBests;
+#endif
+        emit newPersonalBestsChanged(newPersonalBests());
+    }
+}
+
+
+
 /*!
  * \brief Returns true if this is a valid record.
  *
@@ -591,27 +630,15 @@ void Record::updateDistance(double nDistance)
 
 /*!
  * \brief Updates the activity the record belongs to.
+ *
+ * \c activity should be the canonical Activity from the Registry. Repetitions and distance
+ * will be reset if they are not supported by the new activity.
  */
 void Record::updateActivity(Activity *activity)
 {
-    if (m_activity && (m_activity->databaseId() != activity->databaseId())) {
-        m_activity->setDatabaseId(activity->databaseId());
-        m_activity->setName(activity->name());
-        m_activity->setMinRepeats(activity->minRepeats());
-        m_activity->setMaxRepeats(activity->maxRepeats());
-        m_activity->setUseRepeats(activity->useRepeats());
-        m_activity->setUseDistance(activity->useDistance());
-        m_activity->setRecords(activity->records());
-
-        Category *c = m_activity->category();
-        Category *o = activity->category();
-
-        if (c) {
-            c->setDatabaseId(o->databaseId());
-            c->setName(o->name());
-            c->setColor(o->color());
-            c->setActivities(o->activities());
-        }
+    if (activity && m_activity && (m_activity->databaseId() != activity->databaseId())) {
+
+        setActivity(activity);
 
         if (!m_activity->useRepeats()) {
             setRepetitions(0);
@@ -50,11 +50,24 @@ class Record : public QObject
     Q_PROPERTY(float tpr READ tpr NOTIFY tprChanged)
     Q_PROPERTY(float maxSpeed READ maxSpeed WRITE setMaxSpeed NOTIFY maxSpeedChanged)
     Q_PROPERTY(float avgSpeed READ avgSpeed WRITE setAvgSpeed NOTIFY avgSpeedChanged)
+    Q_PROPERTY(int newPersonalBests READ newPersonalBests NOTIFY newPersonalBestsChanged)
+    Q_ENUMS(PersonalBest)
 public:
     explicit Record(QObject *parent = nullptr);
     explicit Record(int databaseId, const QDateTime &start, const QDateTime &end, uint duration, uint repetitions, double distance, const QString &note, float tpr, float maxSpeed, float avgSpeed, QObject *parent = nullptr);
     ~Record();
 
+    /*!
+     * \brief Flags of the personal bests a record has set when it has been finished.
+     */
+    enum PersonalBest {
+        NoPersonalBest = 0,         /*!< The record has not set a personal best. */
+        DistancePersonalBest = 1,   /*!< Longest distance of the activity. */
+        RepetitionsPersonalBest = 2,/*!< Most repetitions of the activity. */
+        TprPersonalBest = 4,        /*!< Lowest time per repetition of the activity. */
+        SpeedPersonalBest = 8       /*!< Top speed of the activity. */
+    };
+
     int databaseId() const;
     Activity *activity() const;
     QDateTime start() const;
@@ -67,6 +80,7 @@ public:
     float tpr() const;
     float maxSpeed() const;
     float avgSpeed() const;
+    int newPersonalBests() const;
 
     void setDatabaseId(int nDatabaseId);
     void setActivity(Activity *nActivity);
@@ -79,6 +93,7 @@ public:
     void setTpr(float nTpr);
     void setMaxSpeed(float nMaxSpeed);
     void setAvgSpeed(float nAvgSpeed);
+    void setNewPersonalBests(int nNewPersonalBests);
 
     Q_INVOKABLE bool isValid() const;
     Q_INVOKABLE void updateDuration(uint nDuration);
@@ -104,6 +119,7 @@ signals:
     void tprChanged(float tpr);
     void maxSpeedChanged(float maxSpeed);
     void avgSpeedChanged(float avgSpeed);
+    void newPersonalBestsChanged(int newPersonalBests);
     /*!
      * \brief Emitted by remove() to indicate that the user wants to delete the record.
      */
@@ -123,6 +139,7 @@ private:
     float m_tpr;
     float m_maxSpeed;
     float m_avgSpeed;
+    int m_newPersonalBests;
 
     void setActive(bool active);
 
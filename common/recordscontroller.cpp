@@ -28,6 +28,11 @@
 #include "configuration.h"
 #include "globals.h"
 #include "distancemeasurement.h"
+#include "registry.h"
+#include "dbmanager.h"
+#include "recordwriter.h"
+#include "rollups.h"
+#include "personalbests.h"
 #include <QProximitySensor>
 #include <QProximityReading>
 #include <QAccelerometer>
@@ -50,6 +55,7 @@ using namespace Gibrievida;
 RecordsController::RecordsController(Configuration *config, QObject *parent) : BaseController(parent), m_config(config)
 {
     m_current = nullptr;
+    m_lastFinished = nullptr;
     m_visible = false;
     m_proximitySensor = nullptr;
     m_accelSensor = nullptr;
@@ -61,6 +67,8 @@ RecordsController::RecordsController(Configuration *config, QObject *parent) : B
     m_distanceMeasurement = nullptr;
     m_soundPlayer = nullptr;
 
+    m_writer = new RecordWriter(this);
+
     m_timer = new QTimer(this);
     m_timer->setInterval(1000);
     m_timer->setTimerType(Qt::VeryCoarseTimer);
@@ -72,42 +80,49 @@ RecordsController::RecordsController(Configuration *config, QObject *parent) : B
 
     connect(m_config, &Configuration::repetitionClickSoundChanged, this, &RecordsController::updateRepetitionClickSound);
 
-    init();
+    DBManager::whenReady(this, [this] () { init(); });
+
+    connect(Registry::instance(), &Registry::reloaded, this, &RecordsController::reload);
 }
 
 
 /*!
  * \brief Destroys the records controler object.
  *
- * If there is a current record it will be saved to the database if it is active.
+ * If there is a current record, its pending changes will be saved to the database.
  */
 RecordsController::~RecordsController()
 {
     if (m_current) {
 
-        if (m_current->isValid()) {
+        m_writer->flush();
+        m_writer->setRecord(nullptr);
 
-#ifdef QT_DEBUG
-            qDebug("Synchronizing the current record data to the database.");
-#endif
+        delete m_current;
+    }
+}
 
-            if (connectDb()) {
 
-                QSqlQuery q(m_db);
+/*!
+ * \brief Drops the current record and loads the active record again after the database has been replaced.
+ */
+void RecordsController::reload()
+{
+    removeSensor();
 
-                if (q.prepare(QStringLiteral("UPDATE records SET repetitions = ?, distance = ? WHERE id = ?"))) {
+    m_finishOnCovering = 0;
 
-                    q.addBindValue(m_current->repetitions());
-                    q.addBindValue(m_current->distance());
-                    q.addBindValue(m_current->databaseId());
+    if (m_current) {
+        Record *r = current();
+        setCurrent(nullptr);
+        delete r;
+    }
 
-                    q.exec();
-                }
-            }
-        }
+    setDistanceMeasurement(nullptr);
 
-        delete m_current;
-    }
+    startStopTimer();
+
+    init();
 }
 
 
@@ -165,13 +180,13 @@ void RecordsController::cancel()
 
             if (connectDb()) {
 
-                QSqlQuery q(m_db);
+                QSqlQuery *q = prepared(QStringLiteral("records_delete"), QStringLiteral("DELETE FROM records WHERE id = ?"));
 
-                if (q.prepare(QStringLiteral("DELETE FROM records WHERE id = ?"))) {
+                if (q) {
 
-                    q.addBindValue(id);
+                    q->addBindValue(id);
 
-                    q.exec();
+                    q->exec();
 
                 }
             }
@@ -231,32 +246,31 @@ int RecordsController::add(Activity *activity, const QString &note, int finishOn
         r = new Record(-1, startTime, QDateTime::fromTime_t(0), 0, 0, 0.0, note, 0.0, 0.0, 0.0);
     }
 
-    Activity *a = new Activity(activity, r);
+    r->setActivity(Registry::instance()->intern(activity));
 
-    r->setActivity(a);
-
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("records_insert"), QStringLiteral("INSERT INTO records (activity, start, note) VALUES (?, ?, ?)"));
 
-    if (!q.prepare(QStringLiteral("INSERT INTO records (activity, start, note) VALUES (?, ?, ?)"))) {
+    if (!q) {
         setCurrent(nullptr);
         delete r;
         return -1;
     }
 
-    q.addBindValue(a->databaseId());
-    q.addBindValue(startTime.toTime_t());
-    q.addBindValue(note);
+    q->addBindValue(r->activity()->databaseId());
+    q->addBindValue(startTime.toTime_t());
+    q->addBindValue(note);
 
-    if (!q.exec()) {
+    if (!q->exec()) {
         setCurrent(nullptr);
         delete r;
         return -1;
     }
 
-    r->setDatabaseId(q.lastInsertId().toInt());
+    r->setDatabaseId(q->lastInsertId().toInt());
 
     if (r->isValid()) {
         setCurrent(r);
+        loadPersonalBests(r->activity());
         m_finishOnCovering = finishOnCovering;
         setSensor();
         return r->databaseId();
@@ -274,7 +288,8 @@ int RecordsController::add(Activity *activity, const QString &note, int finishOn
  * \brief Finishes the current recording.
  *
  * Will set the end time and the calculated duration to the \link RecordsController::current current \endlink Record
- * and synchronizes it's data to the database. On success the finished() signal will be emitted.
+ * and synchronizes it's data to the database. Metrics that improve the personal bests of the activity are stored
+ * and reported in \link Record::newPersonalBests newPersonalBests \endlink. On success the finished() signal will be emitted.
  */
 void RecordsController::finish()
 {
@@ -319,25 +334,33 @@ void RecordsController::finish()
 
     m_timer->stop();
 
-    QSqlQuery q(m_db);
+    // the finishing UPDATE contains all progress data
+    m_writer->discard();
+
+    QSqlQuery *q = prepared(QStringLiteral("records_finish"), QStringLiteral("UPDATE records SET end = ?, duration = ?, repetitions = ?, distance = ?, tpr = ?, maxSpeed = ?, avgSpeed = ? WHERE id = ?"));
+
+    // the bests have been loaded when the record has been started, so this only writes improved metrics
+    Activity *a = m_current->activity();
 
-    if (!q.prepare(QStringLiteral("UPDATE records SET end = ?, duration = ?, repetitions = ?, distance = ?, tpr = ?, maxSpeed = ?, avgSpeed = ? WHERE id = ?"))) {
+    // the finished record and its personal bests are stored together
+    if (!q || !a || !loadPersonalBests(a) || !m_db.transaction()) {
         Record *current = m_current;
         setCurrent(nullptr);
         delete current;
         return;
     }
 
-    q.addBindValue(endTime.toTime_t());
-    q.addBindValue(duration);
-    q.addBindValue(m_current->repetitions());
-    q.addBindValue(m_current->distance());
-    q.addBindValue(tpr);
-    q.addBindValue(m_current->maxSpeed());
-    q.addBindValue(avgSpeed);
-    q.addBindValue(m_current->databaseId());
+    q->addBindValue(endTime.toTime_t());
+    q->addBindValue(duration);
+    q->addBindValue(m_current->repetitions());
+    q->addBindValue(m_current->distance());
+    q->addBindValue(tpr);
+    q->addBindValue(m_current->maxSpeed());
+    q->addBindValue(avgSpeed);
+    q->addBindValue(m_current->databaseId());
 
-    if (!q.exec()) {
+    if (!q->exec()) {
+        m_db.rollback();
         Record *current = m_current;
         setCurrent(nullptr);
         delete current;
@@ -349,8 +372,41 @@ void RecordsController::finish()
     m_current->setTpr(tpr);
     m_current->setAvgSpeed(avgSpeed);
 
+    int newBests = Record::NoPersonalBest;
+    QSqlQuery bq(m_db);
+
+    if (!PersonalBests::update(bq, m_current, a, &newBests)) {
+        m_db.rollback();
+        Record *current = m_current;
+        setCurrent(nullptr);
+        delete current;
+        return;
+    }
+
+    if (!m_db.commit()) {
+        qWarning("Failed to commit the finished record: %s", qUtf8Printable(m_db.lastError().text()));
+        m_db.rollback();
+        if (newBests != Record::NoPersonalBest) {
+            loadPersonalBests(a, true);
+        }
+        Record *current = m_current;
+        setCurrent(nullptr);
+        delete current;
+        return;
+    }
+
+    m_current->setNewPersonalBests(newBests);
+
     emit finished(current());
 
+    // models copy the data of the finished record, so the controller keeps the object
+    // until the next record has been finished
+    if (m_lastFinished) {
+        m_lastFinished->deleteLater();
+    }
+    m_lastFinished = m_current;
+    m_lastFinished->setParent(this);
+
     setCurrent(nullptr);
 
     startStopTimer();
@@ -382,25 +438,41 @@ void RecordsController::update(Record *r, int oldActivityId)
         return;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("records_update"), QStringLiteral("UPDATE records SET activity = ?, start = ?, end = ?, duration = ?, repetitions = ?, distance = ?, note = ?, tpr = ?, avgSpeed = ?, maxSpeed = ? WHERE id = ?"));
+
+    if (!q) {
+        return;
+    }
+
+    if (!m_db.transaction()) {
+        return;
+    }
 
-    if (!q.prepare(QStringLiteral("UPDATE records SET activity = ?, start = ?, end = ?, duration = ?, repetitions = ?, distance = ?, note = ?, tpr = ?, avgSpeed = ?, maxSpeed = ? WHERE id = ?"))) {
+    q->addBindValue(r->activity()->databaseId());
+    q->addBindValue(r->start().toTime_t());
+    q->addBindValue(r->end().toTime_t());
+    q->addBindValue(r->duration());
+    q->addBindValue(r->repetitions());
+    q->addBindValue(r->distance());
+    q->addBindValue(r->note());
+    q->addBindValue(r->tpr());
+    q->addBindValue(r->avgSpeed());
+    q->addBindValue(r->maxSpeed());
+    q->addBindValue(r->databaseId());
+
+    if (!q->exec()) {
+        m_db.rollback();
         return;
     }
 
-    q.addBindValue(r->activity()->databaseId());
-    q.addBindValue(r->start().toTime_t());
-    q.addBindValue(r->end().toTime_t());
-    q.addBindValue(r->duration());
-    q.addBindValue(r->repetitions());
-    q.addBindValue(r->distance());
-    q.addBindValue(r->note());
-    q.addBindValue(r->tpr());
-    q.addBindValue(r->avgSpeed());
-    q.addBindValue(r->maxSpeed());
-    q.addBindValue(r->databaseId());
+    QList<int> activityIds;
+    activityIds << r->activity()->databaseId();
+    if (oldActivityId > 0 && oldActivityId != r->activity()->databaseId()) {
+        activityIds << oldActivityId;
+    }
 
-    if (!q.exec()) {
+    if (!recomputePersonalBests(activityIds)) {
+        m_db.rollback();
         return;
     }
 
@@ -421,15 +493,25 @@ void RecordsController::remove(Record *r)
         return;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("records_delete"), QStringLiteral("DELETE FROM records WHERE id = ?"));
+
+    if (!q) {
+        return;
+    }
 
-    if (!q.prepare(QStringLiteral("DELETE FROM records WHERE id = ?"))) {
+    if (!m_db.transaction()) {
         return;
     }
 
-    q.addBindValue(r->databaseId());
+    q->addBindValue(r->databaseId());
+
+    if (!q->exec()) {
+        m_db.rollback();
+        return;
+    }
 
-    if (!q.exec()) {
+    if (!recomputePersonalBests(QList<int>() << r->activity()->databaseId())) {
+        m_db.rollback();
         return;
     }
 
@@ -459,15 +541,29 @@ void RecordsController::removeByActivity(Activity *a)
         return;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("records_delete_by_activity"), QStringLiteral("DELETE FROM records WHERE activity = ? AND end > 0"));
+
+    if (!q) {
+        return;
+    }
+
+    if (!m_db.transaction()) {
+        return;
+    }
+
+    q->addBindValue(a->databaseId());
 
-    if (!q.prepare(QStringLiteral("DELETE FROM records WHERE activity = ? AND end > 0"))) {
+    if (!q->exec()) {
+        m_db.rollback();
         return;
     }
 
-    q.addBindValue(a->databaseId());
+    QSqlQuery bq(m_db);
+    bq.prepare(QStringLiteral("DELETE FROM personal_bests WHERE activity = ?"));
+    bq.addBindValue(a->databaseId());
 
-    if (!q.exec()) {
+    if (!bq.exec() || !m_db.commit()) {
+        m_db.rollback();
         return;
     }
 
@@ -497,15 +593,29 @@ void RecordsController::removeByCategory(Category *c)
         return;
     }
 
-    QSqlQuery q(m_db);
+    QSqlQuery *q = prepared(QStringLiteral("records_delete_by_category"), QStringLiteral("DELETE FROM records WHERE end > 0 AND activity IN (SELECT id FROM activities WHERE category = ?)"));
+
+    if (!q) {
+        return;
+    }
+
+    if (!m_db.transaction()) {
+        return;
+    }
 
-    if (!q.prepare(QStringLiteral("DELETE FROM records WHERE end > 0 AND activity IN (SELECT id FROM activities WHERE category = ?)"))) {
+    q->addBindValue(c->databaseId());
+
+    if (!q->exec()) {
+        m_db.rollback();
         return;
     }
 
-    q.addBindValue(c->databaseId());
+    QSqlQuery bq(m_db);
+    bq.prepare(QStringLiteral("DELETE FROM personal_bests WHERE activity IN (SELECT id FROM activities WHERE category = ?)"));
+    bq.addBindValue(c->databaseId());
 
-    if (!q.exec()) {
+    if (!bq.exec() || !m_db.commit()) {
+        m_db.rollback();
         return;
     }
 
@@ -524,9 +634,14 @@ void RecordsController::removeAll()
         return;
     }
 
+    if (!m_db.transaction()) {
+        return;
+    }
+
     QSqlQuery q(m_db);
 
-    if (!q.exec(QStringLiteral("DELETE FROM records WHERE end > 0"))) {
+    if (!q.exec(QStringLiteral("DELETE FROM records WHERE end > 0")) || !q.exec(QStringLiteral("DELETE FROM personal_bests")) || !m_db.commit()) {
+        m_db.rollback();
         return;
     }
 
@@ -535,6 +650,114 @@ void RecordsController::removeAll()
 
 
 
+/*!
+ * \brief Returns true if the statistics rollups are consistent with the finished records.
+ *
+ * This compares every rollup row with the aggregated records, so it reads the whole records table.
+ */
+bool RecordsController::checkStatistics()
+{
+    if (!connectDb()) {
+        return false;
+    }
+
+    QSqlQuery q(m_db);
+
+    return Rollups::check(q);
+}
+
+
+
+/*!
+ * \brief Rebuilds the statistics rollups and the personal bests from the finished records.
+ *
+ * On success the statisticsRebuilt() signal will be emitted.
+ */
+bool RecordsController::rebuildStatistics()
+{
+    if (!connectDb()) {
+        return false;
+    }
+
+    if (!m_db.transaction()) {
+        return false;
+    }
+
+    QSqlQuery q(m_db);
+
+    if (!Rollups::rebuild(q) || !PersonalBests::rebuild(q)) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        return false;
+    }
+
+    if (m_current) {
+        loadPersonalBests(m_current->activity(), true);
+    }
+
+    emit statisticsRebuilt();
+
+    return true;
+}
+
+
+
+/*!
+ * \brief Loads the personal bests of the Activity \a a if they have not been loaded yet or if \a force is true.
+ *
+ * This is done when a record is started, so finishing it can compare against the bests without reading them.
+ */
+bool RecordsController::loadPersonalBests(Activity *a, bool force)
+{
+    if (!a) {
+        return false;
+    }
+
+    if (a->hasPersonalBests() && !force) {
+        return true;
+    }
+
+    QSqlQuery q(m_db);
+
+    return PersonalBests::load(q, a);
+}
+
+
+
+/*!
+ * \brief Recalculates the personal bests of the activities in \a activityIds and commits the current transaction.
+ *
+ * On success the personal bests of the affected Activity objects will be reloaded.
+ */
+bool RecordsController::recomputePersonalBests(const QList<int> &activityIds)
+{
+    QSqlQuery q(m_db);
+
+    for (int activityId : activityIds) {
+        if (!PersonalBests::recompute(q, activityId)) {
+            return false;
+        }
+    }
+
+    if (!m_db.commit()) {
+        return false;
+    }
+
+    for (int activityId : activityIds) {
+        Activity *a = Registry::instance()->activity(activityId);
+        if (a) {
+            PersonalBests::load(q, a);
+        }
+    }
+
+    return true;
+}
+
+
+
 /*!
  * \property RecordsController::current
  * \brief The currently active record.
@@ -562,6 +785,7 @@ void RecordsController::setCurrent(Record *nCurrent)
 {
     if (nCurrent != m_current) {
         m_current = nCurrent;
+        m_writer->setRecord(m_current);
 #ifdef QT_DEBUG
         qDebug() << "Changed currentRecord to" << m_current;
 #endif
@@ -620,7 +844,7 @@ void RecordsController::init()
 
     QSqlQuery q(m_db);
 
-    if (!q.exec(QStringLiteral("SELECT r.id, r.activity, a.name, a.category, c.name, c.color, r.start, r.repetitions, r.distance, a.minrepeats, a.maxrepeats, a.distance, r.note, r.tpr, r.maxSpeed, r.avgSpeed, a.sensor, a.sensorDelay FROM records r JOIN activities a ON a.id = r.activity JOIN categories c ON c.id = a.category WHERE r.end = 0 LIMIT 1"))) {
+    if (!q.exec(activeRecordQuery())) {
         setCurrent(nullptr);
         return;
     }
@@ -629,15 +853,15 @@ void RecordsController::init()
         QDateTime startTime = QDateTime::fromTime_t(q.value(6).toUInt());
         Record *r = new Record(q.value(0).toInt(), startTime, QDateTime::fromTime_t(0), startTime.secsTo(QDateTime::currentDateTimeUtc()), q.value(7).toInt(), q.value(8).toDouble(), q.value(12).toString(), q.value(13).toFloat(), q.value(14).toFloat(), q.value(15).toFloat());
 
-        Activity *a = new Activity(q.value(1).toInt(), q.value(2).toString(), q.value(9).toInt(), q.value(10).toInt(), q.value(11).toBool(), 0, q.value(16).toInt(), q.value(17).toInt(), r);
+        Registry *registry = Registry::instance();
 
-        Category *c = new Category(q.value(3).toInt(), q.value(4).toString(), q.value(5).toString(), 0, a);
+        Category *c = registry->category(q.value(3).toInt(), q.value(4).toString(), q.value(5).toString());
 
-        a->setCategory(c);
-        r->setActivity(a);
+        r->setActivity(registry->activity(q.value(1).toInt(), q.value(2).toString(), q.value(9).toInt(), q.value(10).toInt(), q.value(11).toBool(), -1, q.value(16).toInt(), q.value(17).toInt(), c));
 
         if (r->isValid()) {
             setCurrent(r);
+            loadPersonalBests(r->activity());
             setSensor();
         } else {
             setCurrent(nullptr);
@@ -652,6 +876,17 @@ void RecordsController::init()
 
 
 
+/*!
+ * \brief Returns the query that loads the active, not finished record.
+ */
+QString RecordsController::activeRecordQuery()
+{
+    return QStringLiteral("SELECT r.id, r.activity, a.name, a.category, c.name, c.color, r.start, r.repetitions, r.distance, a.minrepeats, a.maxrepeats, a.distance, r.note, r.tpr, r.maxSpeed, r.avgSpeed, a.sensor, a.sensorDelay FROM records r JOIN activities a ON a.id = r.activity JOIN categories c ON c.id = a.category WHERE r.end = 0 LIMIT 1");
+}
+
+
+
+
 /*!
  * \brief Increases the current repetitions by one.
  *
@@ -1000,14 +1235,14 @@ void RecordsController::initialPositionAvailable(bool available)
         }
 
         if (connectDb()) {
-            QSqlQuery q(m_db);
+            QSqlQuery *q = prepared(QStringLiteral("records_update_start"), QStringLiteral("UPDATE records SET start = ? WHERE id = ?"));
 
-            if (q.prepare(QStringLiteral("UPDATE records SET start = ? WHERE id = ?"))) {
+            if (q) {
 
-                q.addBindValue(current()->start().toTime_t());
-                q.addBindValue(current()->databaseId());
+                q->addBindValue(current()->start().toTime_t());
+                q->addBindValue(current()->databaseId());
 
-                q.exec();
+                q->exec();
             }
 
         }
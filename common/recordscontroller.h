@@ -40,6 +40,7 @@ class Activity;
 class Category;
 class Configuration;
 class DistanceMeasurement;
+class RecordWriter;
 
 /*!
  * \brief Controller class to manage Record objects.
@@ -67,6 +68,8 @@ public:
     Q_INVOKABLE void removeByActivity(Gibrievida::Activity *a);
     Q_INVOKABLE void removeByCategory(Gibrievida::Category *c);
     Q_INVOKABLE void removeAll();
+    Q_INVOKABLE bool checkStatistics();
+    Q_INVOKABLE bool rebuildStatistics();
 
     Record *current() const;
     bool isVisible() const;
@@ -74,6 +77,8 @@ public:
 
     void setVisible(bool visible);
 
+    static QString activeRecordQuery();
+
     Q_INVOKABLE void increaseRepetitions();
     Q_INVOKABLE void decreaseRepetitions();
 
@@ -105,6 +110,10 @@ signals:
      * \brief Emitted if all records have been removed successfully from the database.
      */
     void removedAll();
+    /*!
+     * \brief Emitted if the statistics rollups have been rebuilt from the records.
+     */
+    void statisticsRebuilt();
 
     void currentChanged(Record *current);
     void distanceMeasurementChanged(DistanceMeasurement *distanceMeasurement);
@@ -120,11 +129,14 @@ private slots:
     void updateMaxSpeed(qreal speed);
     void initialPositionAvailable(bool available);
     void positionSignalLost();
+    void reload();
 
 private:
     Q_DISABLE_COPY(RecordsController)
 
     void setCurrent(Record *nCurrent);
+    bool loadPersonalBests(Activity *a, bool force = false);
+    bool recomputePersonalBests(const QList<int> &activityIds);
     void setDistanceMeasurement(DistanceMeasurement *nDistanceMeasurement);
 
     void init();
@@ -134,9 +146,11 @@ private:
     void playSound(const QString &soundFile);
 
     Record *m_current;
+    Record *m_lastFinished;
     bool m_visible;
     int m_finishOnCovering;
     DistanceMeasurement *m_distanceMeasurement;
+    RecordWriter *m_writer;
 
     QTimer *m_timer;
     QTimer *m_sensorTimer;
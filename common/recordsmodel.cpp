@@ -20,19 +20,54 @@
 #include "recordsmodel.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QStringBuilder>
 #include <QtCore/qmath.h>
+#include <algorithm>
 #include "recordscontroller.h"
 #include "activitiescontroller.h"
 #include "categoriescontroller.h"
 #include "category.h"
 #include "activity.h"
 #include "record.h"
+#include "registry.h"
 #ifdef QT_DEBUG
 #include <QtDebug>
 #endif
 
+#define RECORDS_PAGE_SIZE 50
+#define RECORDS_RESET_THRESHOLD 100
+
 using namespace Gibrievida;
 
+/*!
+ * \brief Removes all values from \c v where \c drop is true, keeping the order of the remaining values.
+ */
+template<typename T>
+static void compactColumn(QVector<T> &v, const QVector<bool> &drop)
+{
+    int j = 0;
+    for (int i = 0; i < v.size(); ++i) {
+        if (!drop.at(i)) {
+            if (i != j) {
+                v[j] = v.at(i);
+            }
+            ++j;
+        }
+    }
+    v.resize(j);
+}
+
+/*!
+ * \brief Moves the value at \c from to \c to inside \c v.
+ */
+template<typename T>
+static void moveColumnValue(QVector<T> &v, int from, int to)
+{
+    const T value = v.at(from);
+    v.remove(from);
+    v.insert(to, value);
+}
+
 /*!
  * \brief Constructs a new empty records model.
  */
@@ -45,6 +80,11 @@ RecordsModel::RecordsModel(QObject *parent) : DBModel(parent)
     m_categoryId = 0;
     m_order = QStringLiteral("DESC");
     m_orderBy = QStringLiteral("r.start");
+    m_canFetchMore = false;
+    m_lastId = 0;
+    updateSortKey();
+
+    connect(Registry::instance(), &Registry::reloaded, this, &RecordsModel::update);
 }
 
 
@@ -64,6 +104,21 @@ QHash<int, QByteArray> RecordsModel::roleNames() const
 {
     QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
     roles.insert(Item, QByteArrayLiteral("item"));
+    roles.insert(DatabaseId, QByteArrayLiteral("databaseId"));
+    roles.insert(ActivityId, QByteArrayLiteral("activityId"));
+    roles.insert(ActivityName, QByteArrayLiteral("activityName"));
+    roles.insert(CategoryId, QByteArrayLiteral("categoryId"));
+    roles.insert(CategoryName, QByteArrayLiteral("categoryName"));
+    roles.insert(CategoryColor, QByteArrayLiteral("categoryColor"));
+    roles.insert(Start, QByteArrayLiteral("start"));
+    roles.insert(End, QByteArrayLiteral("end"));
+    roles.insert(Duration, QByteArrayLiteral("duration"));
+    roles.insert(Repetitions, QByteArrayLiteral("repetitions"));
+    roles.insert(Distance, QByteArrayLiteral("distance"));
+    roles.insert(Note, QByteArrayLiteral("note"));
+    roles.insert(Tpr, QByteArrayLiteral("tpr"));
+    roles.insert(MaxSpeed, QByteArrayLiteral("maxSpeed"));
+    roles.insert(AvgSpeed, QByteArrayLiteral("avgSpeed"));
     return roles;
 }
 
@@ -75,7 +130,7 @@ QHash<int, QByteArray> RecordsModel::roleNames() const
 int RecordsModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_records.count();
+    return m_ids.count();
 }
 
 
@@ -102,127 +157,616 @@ QVariant RecordsModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    if (index.row() > (m_records.count()-1)) {
+    const int row = index.row();
+
+    if (row > (m_ids.count()-1)) {
         return QVariant();
     }
 
-    if (role == Item) {
-        return QVariant::fromValue<Record*>(m_records.at(index.row()));
-    } else {
+    switch (role) {
+    case Item:
+        return QVariant::fromValue<Record*>(item(row));
+    case DatabaseId:
+        return QVariant::fromValue(m_ids.at(row));
+    case ActivityId:
+        return QVariant::fromValue(m_activityIds.at(row));
+    case ActivityName:
+        return QVariant::fromValue(activity(row)->name());
+    case CategoryId:
+        return QVariant::fromValue(activity(row)->category()->databaseId());
+    case CategoryName:
+        return QVariant::fromValue(activity(row)->category()->name());
+    case CategoryColor:
+        return QVariant::fromValue(activity(row)->category()->color());
+    case Start:
+        return QVariant::fromValue(QDateTime::fromTime_t(static_cast<uint>(m_starts.at(row))));
+    case End:
+        return QVariant::fromValue(QDateTime::fromTime_t(static_cast<uint>(m_ends.at(row))));
+    case Duration:
+        return QVariant::fromValue(m_durations.at(row));
+    case Repetitions:
+        return QVariant::fromValue(m_repetitions.at(row));
+    case Distance:
+        return QVariant::fromValue(m_distances.at(row));
+    case Note:
+        return QVariant::fromValue(m_notes.at(m_noteIndexes.at(row)));
+    case Tpr:
+        return QVariant::fromValue(m_tprs.at(row));
+    case MaxSpeed:
+        return QVariant::fromValue(m_maxSpeeds.at(row));
+    case AvgSpeed:
+        return QVariant::fromValue(m_avgSpeeds.at(row));
+    default:
         return QVariant();
     }
 }
 
 
 
+/*!
+ * \brief Returns the Record object for the model \c row.
+ *
+ * The model stores its data in plain columns, Record objects are only created on demand, for example to
+ * show or edit a single record. The created Record will be owned by the model and destroyed if the row is
+ * removed. Returns a \c nullptr if \c row is out of range.
+ */
+Record *RecordsModel::get(int row)
+{
+    if (row < 0 || row > (m_ids.count()-1)) {
+        return nullptr;
+    }
+
+    return item(row);
+}
+
+
+
+/*!
+ * \brief Returns the Record object for the record with \c databaseId.
+ *
+ * Returns a \c nullptr if the record is not part of the model (anymore).
+ */
+Record *RecordsModel::getByDatabaseId(int databaseId)
+{
+    const int row = m_rows.value(databaseId, -1);
+
+    return (row < 0) ? nullptr : item(row);
+}
+
+
+
+/*!
+ * \brief Returns the Record object for \c row, creating it if it does not exist.
+ */
+Record *RecordsModel::item(int row) const
+{
+    const int id = m_ids.at(row);
+
+    Record *r = m_items.value(id);
+
+    if (r) {
+        return r;
+    }
+
+    RecordsModel *that = const_cast<RecordsModel*>(this);
+
+    r = new Record(id,
+                   QDateTime::fromTime_t(static_cast<uint>(m_starts.at(row))),
+                   QDateTime::fromTime_t(static_cast<uint>(m_ends.at(row))),
+                   m_durations.at(row),
+                   m_repetitions.at(row),
+                   m_distances.at(row),
+                   m_notes.at(m_noteIndexes.at(row)),
+                   m_tprs.at(row),
+                   m_maxSpeeds.at(row),
+                   m_avgSpeeds.at(row),
+                   that);
+
+    r->setActivity(activity(row));
+
+    connect(r, &Record::startRemoving, that, [that, id] () {
+        emit that->removeRequested(id);
+    });
+
+    m_items.insert(id, r);
+
+    return r;
+}
+
+
+
+/*!
+ * \brief Returns the Activity of the record at \c row.
+ */
+Activity *RecordsModel::activity(int row) const
+{
+    return m_activities.value(m_activityIds.at(row));
+}
+
+
+
+/*!
+ * \brief Returns the canonical Activity object for \c a and references it for the records.
+ *
+ * The model references the canonical Activity from the Registry for every activity used by the records.
+ */
+Activity *RecordsModel::addActivity(Activity *a)
+{
+    Activity *ma = Registry::instance()->intern(a);
+
+    m_activities.insert(ma->databaseId(), ma);
+
+    return ma;
+}
+
+
+
+/*!
+ * \brief Returns the index of \c note in the list of notes, adding it if needed.
+ *
+ * Notes are stored only once, so that records with the same or an empty note share the same string.
+ */
+int RecordsModel::noteIndex(const QString &note)
+{
+    int idx = m_noteIndex.value(note, -1);
+
+    if (idx < 0) {
+        idx = m_notes.size();
+        m_notes.append(note);
+        m_noteIndex.insert(note, idx);
+    }
+
+    return idx;
+}
+
+
+
+/*!
+ * \brief Inserts the data of Record \c r at \c row into the model columns.
+ *
+ * This will not call beginInsertRows() and endInsertRows().
+ */
+void RecordsModel::insertRecord(int row, Record *r)
+{
+    addActivity(r->activity());
+
+    m_activityRecords[r->activity()->databaseId()].insert(r->databaseId());
+
+    m_ids.insert(row, r->databaseId());
+    m_activityIds.insert(row, r->activity()->databaseId());
+    m_starts.insert(row, r->start().toTime_t());
+    m_ends.insert(row, r->end().toTime_t());
+    m_durations.insert(row, r->duration());
+    m_repetitions.insert(row, r->repetitions());
+    m_distances.insert(row, r->distance());
+    m_noteIndexes.insert(row, noteIndex(r->note()));
+    m_tprs.insert(row, r->tpr());
+    m_maxSpeeds.insert(row, r->maxSpeed());
+    m_avgSpeeds.insert(row, r->avgSpeed());
+
+    reindex(row);
+}
+
+
+
+/*!
+ * \brief Removes the rows from \c first to \c last from the model columns.
+ *
+ * Record objects created for this rows will be destroyed. This will not call beginRemoveRows() and endRemoveRows().
+ */
+void RecordsModel::removeRecords(int first, int last)
+{
+    const int count = last - first + 1;
+
+    for (int i = first; i <= last; ++i) {
+        const int id = m_ids.at(i);
+        delete m_items.take(id);
+        m_rows.remove(id);
+        unindexActivity(m_activityIds.at(i), id);
+    }
+
+    m_ids.remove(first, count);
+    m_activityIds.remove(first, count);
+    m_starts.remove(first, count);
+    m_ends.remove(first, count);
+    m_durations.remove(first, count);
+    m_repetitions.remove(first, count);
+    m_distances.remove(first, count);
+    m_noteIndexes.remove(first, count);
+    m_tprs.remove(first, count);
+    m_maxSpeeds.remove(first, count);
+    m_avgSpeeds.remove(first, count);
+
+    reindex(first);
+}
+
+
+
+/*!
+ * \brief Moves the record at row \c from to row \c to in the model columns.
+ *
+ * \c to is the row in the list after the move. This will not call beginMoveRows() and endMoveRows().
+ */
+void RecordsModel::moveRecord(int from, int to)
+{
+    moveColumnValue(m_ids, from, to);
+    moveColumnValue(m_activityIds, from, to);
+    moveColumnValue(m_starts, from, to);
+    moveColumnValue(m_ends, from, to);
+    moveColumnValue(m_durations, from, to);
+    moveColumnValue(m_repetitions, from, to);
+    moveColumnValue(m_distances, from, to);
+    moveColumnValue(m_noteIndexes, from, to);
+    moveColumnValue(m_tprs, from, to);
+    moveColumnValue(m_maxSpeeds, from, to);
+    moveColumnValue(m_avgSpeeds, from, to);
+
+    reindex(qMin(from, to));
+}
+
+
+
+/*!
+ * \brief Removes the rows in the sorted list \c rows from the model.
+ *
+ * Adjacent rows are grouped into contiguous ranges, every range is removed in a single model transaction,
+ * starting with the last range so that the rows of the remaining ranges stay valid. If more than
+ * RECORDS_RESET_THRESHOLD rows are affected, the rows will be removed in one pass inside a model reset.
+ */
+void RecordsModel::removeRowList(const QList<int> &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    if (rows.size() > RECORDS_RESET_THRESHOLD) {
+
+        beginResetModel();
+
+        QVector<bool> drop(m_ids.size(), false);
+
+        for (int row : rows) {
+            const int id = m_ids.at(row);
+            drop[row] = true;
+            delete m_items.take(id);
+            m_rows.remove(id);
+            unindexActivity(m_activityIds.at(row), id);
+        }
+
+        compactColumn(m_ids, drop);
+        compactColumn(m_activityIds, drop);
+        compactColumn(m_starts, drop);
+        compactColumn(m_ends, drop);
+        compactColumn(m_durations, drop);
+        compactColumn(m_repetitions, drop);
+        compactColumn(m_distances, drop);
+        compactColumn(m_noteIndexes, drop);
+        compactColumn(m_tprs, drop);
+        compactColumn(m_maxSpeeds, drop);
+        compactColumn(m_avgSpeeds, drop);
+
+        reindex(0);
+
+        endResetModel();
+
+        return;
+    }
+
+    int last = rows.last();
+    int first = last;
+
+    for (int i = rows.size() - 2; i >= -1; --i) {
+
+        if (i > -1 && rows.at(i) == (first - 1)) {
+            first = rows.at(i);
+            continue;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+
+        removeRecords(first, last);
+
+        endRemoveRows();
+
+        if (i > -1) {
+            first = rows.at(i);
+            last = first;
+        }
+    }
+}
+
+
+
+/*!
+ * \brief Updates the row index of the records starting at \c row.
+ */
+void RecordsModel::reindex(int row)
+{
+    for (int i = row; i < m_ids.size(); ++i) {
+        m_rows.insert(m_ids.at(i), i);
+    }
+}
+
+
+
+/*!
+ * \brief Removes the record identified by \c databaseId from the records index of \c activity.
+ */
+void RecordsModel::unindexActivity(int activity, int databaseId)
+{
+    QHash<int, QSet<int>>::iterator it = m_activityRecords.find(activity);
+
+    if (it != m_activityRecords.end()) {
+        it.value().remove(databaseId);
+        if (it.value().isEmpty()) {
+            m_activityRecords.erase(it);
+        }
+    }
+}
+
+
+
 
 /*!
  * \brief Initializes the model data from the SQL database.
+ *
+ * Clears the model and loads the first page of records. Further pages will be loaded by fetchMore().
  */
 void RecordsModel::update()
 {
-    setInOperation(true);
-
     clear();
 
-    if (!connectDb()) {
-        setInOperation(false);
+    m_canFetchMore = true;
+
+    fetchMore(QModelIndex());
+}
+
+
+
+/*!
+ * \brief Reimplemented from QAbstractItemModel.
+ *
+ * Returns true as long as the last loaded page has been a full page and no page is currently loading.
+ */
+bool RecordsModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return false;
+    }
+
+    return (m_canFetchMore && !isQueryRunning());
+}
+
+
+
+/*!
+ * \brief Reimplemented from QAbstractItemModel.
+ *
+ * Requests the next page of records that follows the last loaded record in the current sort order.
+ * The page is loaded asynchronously by the DBWorker and added to the model in queryFinished().
+ */
+void RecordsModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_canFetchMore || isQueryRunning()) {
         return;
     }
 
-    QString queryString = QStringLiteral("SELECT r.id, r.activity, a.name, a.category, c.name, c.color, r.start, r.end, r.duration, r.repetitions, r.distance, a.minRepeats, a.maxRepeats, a.distance, r.note, r.tpr, r.maxSpeed, r.avgSpeed, a.sensor, a.sensorDelay FROM records r JOIN activities a ON a.id = r.activity JOIN categories c ON c.id = a.category WHERE r.end > 0");
+    QVariantList bindValues;
+
+    if (!m_searchTerms.isEmpty()) {
+        bindValues.append(m_searchTerms.join(QLatin1String("* ")).append(QLatin1Char('*')));
+    }
 
     if (m_categoryId > 0) {
-        queryString.append(QLatin1String(" AND a.category = ?"));
+        bindValues.append(m_categoryId);
     } else if (m_activityId > 0) {
+        bindValues.append(m_activityId);
+    }
+
+    if (m_lastKey.isValid()) {
+        bindValues.append(m_lastKey);
+        bindValues.append(m_lastKey);
+        bindValues.append(m_lastId);
+    }
+
+    bindValues.append(RECORDS_PAGE_SIZE);
+
+    startQuery(pageQuery(sortColumn(), isDescending(), m_activityId, m_categoryId, !m_searchTerms.isEmpty(), m_lastKey.isValid()), bindValues);
+}
+
+
+
+/*!
+ * \brief Returns the query that loads a page of finished records sorted by \a column.
+ *
+ * The bind values of the query are, in this order: the search terms if \a search is true, the
+ * category ID if \a categoryId is valid or else the activity ID if \a activityId is valid, the sort value
+ * of the cursor twice and its record ID if \a afterCursor is true, and the page size.
+ */
+QString RecordsModel::pageQuery(const QString &column, bool descending, int activityId, int categoryId, bool search, bool afterCursor)
+{
+    QString queryString = QStringLiteral("SELECT r.id, r.activity, a.name, a.category, c.name, c.color, r.start, r.end, r.duration, r.repetitions, r.distance, a.minRepeats, a.maxRepeats, a.distance, r.note, r.tpr, r.maxSpeed, r.avgSpeed, a.sensor, a.sensorDelay, ");
+
+    if (!search) {
+        queryString.append(column).append(QLatin1String(" FROM records r JOIN activities a ON a.id = r.activity JOIN categories c ON c.id = a.category WHERE r.end > 0"));
+    } else {
+        // the search index drives the query, only the matching records are sorted
+        queryString.append(column).append(QLatin1String(" FROM records_search s CROSS JOIN records r ON r.id = s.rowid JOIN activities a ON a.id = r.activity JOIN categories c ON c.id = a.category WHERE records_search MATCH ? AND r.end > 0"));
+    }
+
+    // the unary plus keeps the category filter off the activity indexes, the sort index is used instead
+    if (categoryId > 0) {
+        queryString.append(QLatin1String(" AND +r.activity IN (SELECT id FROM activities WHERE category = ?)"));
+    } else if (activityId > 0) {
         queryString.append(QLatin1String(" AND r.activity = ?"));
     }
 
-    if (m_orderBy == QLatin1String("r.repetitions")) {
+    if (column == QLatin1String("r.repetitions")) {
         queryString.append(QLatin1String(" AND r.repetitions > 0"));
-    } else if (m_orderBy == QLatin1String("r.distance")) {
+    } else if (column == QLatin1String("r.distance")) {
         queryString.append(QLatin1String(" AND r.distance > 0.0"));
     }
 
-    queryString.append(QLatin1String(" ORDER BY ")).append(m_orderBy).append(QLatin1String(" ")).append(m_order);
+    const QLatin1String cmp = descending ? QLatin1String(" < ") : QLatin1String(" > ");
 
-    QSqlQuery q(m_db);
-
-    if (!q.prepare(queryString)) {
-        setInOperation(false);
-        return;
+    // the first condition bounds the index range, SQLite can not use the OR for that
+    if (afterCursor) {
+        queryString.append(QLatin1String(" AND ")).append(column).append(descending ? QLatin1String(" <= ") : QLatin1String(" >= ")).append(QLatin1String("? AND (")).append(column).append(cmp).append(QLatin1String("? OR r.id")).append(cmp).append(QLatin1String("?)"));
     }
 
-    if (m_categoryId > 0) {
-        q.addBindValue(m_categoryId);
-    } else if (m_activityId > 0) {
-        q.addBindValue(m_activityId);
-    }
+    const QLatin1String dir = descending ? QLatin1String(" DESC") : QLatin1String(" ASC");
+
+    queryString.append(QLatin1String(" ORDER BY ")).append(column).append(dir).append(QLatin1String(", r.id")).append(dir).append(QLatin1String(" LIMIT ?"));
+
+    return queryString;
+}
+
 
-    if (!q.exec()) {
-        setInOperation(false);
+
+/*!
+ * \brief Returns the columns the records can be sorted by.
+ */
+QStringList RecordsModel::sortColumns()
+{
+    return QStringList({QStringLiteral("r.start"), QStringLiteral("r.duration"), QStringLiteral("r.repetitions"), QStringLiteral("r.distance")});
+}
+
+
+
+/*!
+ * \brief Adds the loaded page of records to the model.
+ */
+void RecordsModel::queryFinished(const DBRows &rows)
+{
+    m_canFetchMore = (rows.size() == RECORDS_PAGE_SIZE);
+
+    if (rows.isEmpty()) {
         return;
     }
 
-    QList<Record*> t_records;
+    const int first = rowCount();
 
-    while (q.next()) {
-        Record *r = new Record(q.value(0).toInt(),
-                               QDateTime::fromTime_t(q.value(6).toUInt()),
-                               QDateTime::fromTime_t(q.value(7).toUInt()),
-                               q.value(8).toUInt(),
-                               q.value(9).toUInt(),
-                               q.value(10).toDouble(),
-                               q.value(14).toString(),
-                               q.value(15).toFloat(),
-                               q.value(16).toFloat(),
-                               q.value(17).toFloat(),
-                               this
-                               );
+    beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
 
-        Activity *a = new Activity(q.value(1).toInt(), q.value(2).toString(), q.value(11).toInt(), q.value(12).toInt(), q.value(13).toBool(), 0, q.value(17).toInt(), q.value(18).toInt(), r);
+    const int newSize = first + rows.size();
+    m_ids.reserve(newSize);
+    m_activityIds.reserve(newSize);
+    m_starts.reserve(newSize);
+    m_ends.reserve(newSize);
+    m_durations.reserve(newSize);
+    m_repetitions.reserve(newSize);
+    m_distances.reserve(newSize);
+    m_noteIndexes.reserve(newSize);
+    m_tprs.reserve(newSize);
+    m_maxSpeeds.reserve(newSize);
+    m_avgSpeeds.reserve(newSize);
 
-        Category *c = new Category(q.value(3).toInt(), q.value(4).toString(), q.value(5).toString(), 0, a);
+    Registry *registry = Registry::instance();
 
-        a->setCategory(c);
-        r->setActivity(a);
+    for (const QVariantList &row : rows) {
 
-        if (r->isValid()) {
-            t_records.append(r);
-        } else {
-            delete r;
+        const int activityId = row.at(1).toInt();
+
+        if (!m_activities.contains(activityId)) {
+            Category *c = registry->category(row.at(3).toInt(), row.at(4).toString(), row.at(5).toString());
+            m_activities.insert(activityId, registry->activity(activityId, row.at(2).toString(), row.at(11).toInt(), row.at(12).toInt(), row.at(13).toBool(), -1, row.at(18).toInt(), row.at(19).toInt(), c));
         }
 
+        const int id = row.at(0).toInt();
+
+        m_rows.insert(id, m_ids.size());
+        m_activityRecords[activityId].insert(id);
+
+        m_ids.append(id);
+        m_activityIds.append(activityId);
+        m_starts.append(row.at(6).toLongLong());
+        m_ends.append(row.at(7).toLongLong());
+        m_durations.append(row.at(8).toUInt());
+        m_repetitions.append(row.at(9).toUInt());
+        m_distances.append(row.at(10).toDouble());
+        m_noteIndexes.append(noteIndex(row.at(14).toString()));
+        m_tprs.append(row.at(15).toFloat());
+        m_maxSpeeds.append(row.at(16).toFloat());
+        m_avgSpeeds.append(row.at(17).toFloat());
+
+        m_lastId = id;
+        m_lastKey = row.at(20);
     }
 
-    if (!t_records.isEmpty()) {
+    endInsertRows();
+}
 
-        beginInsertRows(QModelIndex(), 0, t_records.size()-1);
 
-        m_records = t_records;
 
-        endInsertRows();
+/*!
+ * \brief Returns the table column used to sort the records.
+ *
+ * Falls back to the start time if \link RecordsModel::orderBy orderBy \endlink contains an unsupported column.
+ */
+QString RecordsModel::sortColumn() const
+{
+    if (sortColumns().contains(m_orderBy)) {
+        return m_orderBy;
     }
 
-    setInOperation(false);
+    return QStringLiteral("r.start");
+}
+
+
+
+/*!
+ * \brief Returns true if the records are sorted in descending order.
+ */
+bool RecordsModel::isDescending() const
+{
+    return (m_order.compare(QLatin1String("ASC"), Qt::CaseInsensitive) != 0);
 }
 
 
 /*!
  * \brief Clears the model and removes all model items.
+ *
+ * A running page query is canceled and the keyset cursor is reset, so no further pages are loaded
+ * until update() is called.
  */
 void RecordsModel::clear()
 {
-    if (!m_records.isEmpty()) {
+    cancelQuery();
+
+    m_canFetchMore = false;
+    m_lastKey = QVariant();
+    m_lastId = 0;
+
+    if (!m_ids.isEmpty()) {
 
         beginRemoveRows(QModelIndex(), 0, rowCount()-1);
 
-        qDeleteAll(m_records);
-        m_records.clear();
+        qDeleteAll(m_items);
+        m_items.clear();
+
+        m_rows.clear();
+        m_activityRecords.clear();
+
+        m_ids.clear();
+        m_activityIds.clear();
+        m_starts.clear();
+        m_ends.clear();
+        m_durations.clear();
+        m_repetitions.clear();
+        m_distances.clear();
+        m_noteIndexes.clear();
+        m_tprs.clear();
+        m_maxSpeeds.clear();
+        m_avgSpeeds.clear();
 
         endRemoveRows();
 
     }
+
+    m_activities.clear();
+
+    m_notes.clear();
+    m_noteIndex.clear();
 }
 
 
@@ -247,6 +791,7 @@ void RecordsModel::setRecordsController(RecordsController *recordsController)
 {
     if (m_recsController) {
         disconnect(m_recsController, &RecordsController::finished, this, &RecordsModel::finished);
+        disconnect(m_recsController, &RecordsController::updated, this, &RecordsModel::updated);
         disconnect(m_recsController, &RecordsController::removed, this, &RecordsModel::removed);
         disconnect(m_recsController, &RecordsController::removedAll, this, &RecordsModel::removedAll);
         disconnect(m_recsController, &RecordsController::removedByActivity, this, &RecordsModel::removedByActivity);
@@ -260,6 +805,7 @@ void RecordsModel::setRecordsController(RecordsController *recordsController)
 
     if (m_recsController) {
         connect(m_recsController, &RecordsController::finished, this, &RecordsModel::finished);
+        connect(m_recsController, &RecordsController::updated, this, &RecordsModel::updated);
         connect(m_recsController, &RecordsController::removed, this, &RecordsModel::removed);
         connect(m_recsController, &RecordsController::removedAll, this, &RecordsModel::removedAll);
         connect(m_recsController, &RecordsController::removedByActivity, this, &RecordsModel::removedByActivity);
@@ -422,6 +968,7 @@ void RecordsModel::setOrder(const QString &order)
 {
     if (m_order != order) {
         m_order = order;
+        updateSortKey();
 #ifdef QT_DEBUG
         qDebug() << " Set order to" << m_order;
 #endif
@@ -454,6 +1001,7 @@ void RecordsModel::setOrderBy(const QString &orderBy)
 {
     if (m_orderBy != orderBy) {
         m_orderBy = orderBy;
+        updateSortKey();
 #ifdef QT_DEBUG
         qDebug() << " Set orderBy to" << m_orderBy;
 #endif
@@ -464,70 +1012,153 @@ void RecordsModel::setOrderBy(const QString &orderBy)
 
 
 /*!
- * \brief Returns the model index of the record identified by \c databaseId.
+ * \property RecordsModel::search
+ * \brief Search string to filter the records by.
+ *
+ * Every word of the search string has to be the beginning of a word in the record note, the activity
+ * name or the category name. The records are searched through the records_search full-text index.
+ * Changing the search string reloads the model.
+ *
+ * \par Access functions:
+ * <TABLE><TR><TD>QString</TD><TD>getSearch() const</TD></TR><TR><TD>void</TD><TD>setSearch(const QString &search)</TD></TR></TABLE>
+ * \par Notifier signal:
+ * <TABLE><TR><TD>void</TD><TD>searchChanged(const QString &search)</TD></TR></TABLE>
  */
-int RecordsModel::find(int databaseId) const
+
+/*!
+ * \brief Part of the \link RecordsModel::search search \endlink property.
+ */
+QString RecordsModel::getSearch() const { return m_search; }
+
+/*!
+ * \brief Part of the \link RecordsModel::search search \endlink property.
+ */
+void RecordsModel::setSearch(const QString &search)
 {
-    if (m_records.isEmpty()) {
-        return -1;
+    if (m_search != search) {
+        m_search = search;
+#ifdef QT_DEBUG
+        qDebug() << " Set search to" << m_search;
+#endif
+        emit searchChanged(getSearch());
+
+        const QStringList terms = searchTerms(m_search);
+        if (terms != m_searchTerms) {
+            m_searchTerms = terms;
+            update();
+        }
     }
+}
 
-    int idx = -1;
 
-    for (int i = 0; i < m_records.size(); ++i) {
-        if (m_records.at(i)->databaseId() == databaseId) {
-            idx = i;
-            break;
+
+/*!
+ * \brief Splits the \a search string into lower case words for prefix queries.
+ *
+ * Everything that is not a letter or a number separates words, so the terms can not contain
+ * full-text query syntax.
+ */
+QStringList RecordsModel::searchTerms(const QString &search)
+{
+    QString cleaned = search.toLower();
+
+    for (QChar &ch : cleaned) {
+        if (!ch.isLetterOrNumber()) {
+            ch = QLatin1Char(' ');
         }
     }
 
-    return idx;
+    return cleaned.split(QLatin1Char(' '), QString::SkipEmptyParts);
+}
+
+
+
+/*!
+ * \brief Returns true if every search term is the beginning of a word in the note, activity or category of the \a record.
+ *
+ * Used for records that are added or changed while the model is loaded, without querying the search index.
+ */
+bool RecordsModel::matchesSearch(Record *record) const
+{
+    const QStringList words = searchTerms(record->note() % QLatin1Char(' ') % record->activity()->name() % QLatin1Char(' ') % record->activity()->category()->name());
+
+    for (const QString &term : m_searchTerms) {
+        bool found = false;
+        for (const QString &word : words) {
+            if (word.startsWith(term)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+/*!
+ * \brief Returns the model index of the record identified by \c databaseId.
+ *
+ * If the record is not in the model, \c -1 will be returned.
+ */
+int RecordsModel::find(int databaseId) const
+{
+    return m_rows.value(databaseId, -1);
 }
 
 
 /*!
- * \brief Returns a list of model indeces of records that are part of \c activity.
+ * \brief Returns a sorted list of model indeces of records that are part of \c activity.
  *
  * \c activity is the database ID of the Activity.
  */
 QList<int> RecordsModel::findByActivity(int activity) const
 {
-    if (m_records.isEmpty()) {
+    const QSet<int> ids = m_activityRecords.value(activity);
+
+    if (ids.isEmpty()) {
         return QList<int>();
     }
 
     QList<int> idxs;
+    idxs.reserve(ids.size());
 
-    for (int i = 0; i < m_records.size(); ++i) {
-        if (m_records.at(i)->activity()->databaseId() == activity) {
-            idxs.append(i);
-        }
+    for (int id : ids) {
+        idxs.append(m_rows.value(id));
     }
 
+    std::sort(idxs.begin(), idxs.end());
+
     return idxs;
 }
 
 
 
 /*!
- * \brief Returns a list of model indeces of records that are part of \c category.
+ * \brief Returns a sorted list of model indeces of records that are part of \c category.
  *
- * \c category is the database ID of the Category.
+ * \c category is the database ID of the Category. The rows are looked up through the activities
+ * of the category, so a changed category of an activity does not need any reindexing.
  */
 QList<int> RecordsModel::findByCategory(int category) const
 {
-    if (m_records.isEmpty()) {
-        return QList<int>();
-    }
-
     QList<int> idxs;
 
-    for (int i = 0; i < m_records.size(); ++i) {
-        if (m_records.at(i)->activity()->category()->databaseId() == category) {
-            idxs.append(i);
+    for (QHash<int, QSet<int>>::const_iterator it = m_activityRecords.constBegin(); it != m_activityRecords.constEnd(); ++it) {
+        Activity *a = m_activities.value(it.key());
+        if (a && a->category() && a->category()->databaseId() == category) {
+            for (int id : it.value()) {
+                idxs.append(m_rows.value(id));
+            }
         }
     }
 
+    std::sort(idxs.begin(), idxs.end());
+
     return idxs;
 }
 
@@ -535,41 +1166,365 @@ QList<int> RecordsModel::findByCategory(int category) const
 
 /*!
  * \brief Adds a finished Record to the model.
+ *
+ * The data of the \c record is copied into the model, the model does not take ownership of it.
  */
 void RecordsModel::finished(Record *record)
 {
     // let's check if the new record is part of the current model data
     // model might display all records or only records for a specific category or activity
-    if ((m_activityId <= 0 && m_categoryId <= 0) || m_categoryId == record->activity()->category()->databaseId() || m_activityId == record->activity()->databaseId()) {
+    if (!record->isValid() || !acceptsRecord(record)) {
+        return;
+    }
+
+    insertSorted(record);
+}
+
+
+
+/*!
+ * \brief Inserts the data of \c record at its sorted position.
+ */
+void RecordsModel::insertSorted(Record *record)
+{
+    const double value = sortValue(record);
+
+    // records behind the last loaded page will be part of a later page
+    if (isBehindLoadedPages(value, record->databaseId())) {
+        reloadRunningPage();
+        return;
+    }
+
+    const int pos = insertPosition(value, record->databaseId());
+
+    beginInsertRows(QModelIndex(), pos, pos);
+    insertRecord(pos, record);
+    endInsertRows();
+}
+
+
+
+/*!
+ * \brief Returns true if \c record matches the current filter of the model.
+ *
+ * Checks the activity or category filter and, if sorted by repetitions or distance,
+ * if the record has repetitions or a distance.
+ */
+bool RecordsModel::acceptsRecord(Record *record) const
+{
+    if (m_categoryId > 0 && record->activity()->category()->databaseId() != m_categoryId) {
+        return false;
+    }
+
+    if (m_categoryId <= 0 && m_activityId > 0 && record->activity()->databaseId() != m_activityId) {
+        return false;
+    }
+
+    if (!m_searchTerms.isEmpty() && !matchesSearch(record)) {
+        return false;
+    }
+
+    if (m_sortKey == SortByRepetitions) {
+        return record->repetitions() > 0;
+    } else if (m_sortKey == SortByDistance) {
+        return record->distance() > 0.0;
+    }
+
+    return true;
+}
+
+
+
+/*!
+ * \brief Returns the value of the current sort column for the record at \c row.
+ */
+double RecordsModel::sortValue(int row) const
+{
+    switch (m_sortKey) {
+    case SortByDuration:
+        return m_durations.at(row);
+    case SortByRepetitions:
+        return m_repetitions.at(row);
+    case SortByDistance:
+        return m_distances.at(row);
+    default:
+        return m_starts.at(row);
+    }
+}
+
+
+
+/*!
+ * \brief Returns the value of the current sort column for \c record.
+ */
+double RecordsModel::sortValue(Record *record) const
+{
+    switch (m_sortKey) {
+    case SortByDuration:
+        return record->duration();
+    case SortByRepetitions:
+        return record->repetitions();
+    case SortByDistance:
+        return record->distance();
+    default:
+        return record->start().toTime_t();
+    }
+}
+
+
+
+/*!
+ * \brief Returns true if the record at \c row is sorted before a record with \c value and \c databaseId.
+ *
+ * Uses the same order as the database query: the sort column first, the record ID second.
+ */
+bool RecordsModel::sortsBefore(int row, double value, int databaseId) const
+{
+    const double rowValue = sortValue(row);
+
+    if (rowValue == value) {
+        return m_descending ? (m_ids.at(row) > databaseId) : (m_ids.at(row) < databaseId);
+    }
+
+    return m_descending ? (rowValue > value) : (rowValue < value);
+}
+
 
-        if (record->isValid()) {
-            record->setParent(this);
+
+/*!
+ * \brief Starts the running page query again from the same cursor.
+ *
+ * A running query might have read the records before a change that moved a record into its range,
+ * so it is restarted to return the changed record. Does nothing if no query is running.
+ */
+void RecordsModel::reloadRunningPage()
+{
+    if (!isQueryRunning()) {
+        return;
+    }
+
+    cancelQuery();
+    fetchMore(QModelIndex());
+}
+
+
+
+/*!
+ * \brief Returns true if a record with \c value and \c databaseId will be loaded by a later page.
+ *
+ * Compares against the keyset cursor of the last loaded page, that is the boundary of the next page
+ * query. The cursor keeps its values if the record it has been taken from changes, because the loaded
+ * range does not change with it. Returns false if all records have been loaded.
+ */
+bool RecordsModel::isBehindLoadedPages(double value, int databaseId) const
+{
+    if (!m_canFetchMore && !isQueryRunning()) {
+        return false;
+    }
+
+    // nothing has been loaded yet, the first page will return the record
+    if (!m_lastKey.isValid()) {
+        return true;
+    }
+
+    const double lastValue = m_lastKey.toDouble();
+
+    if (value == lastValue) {
+        return m_descending ? (databaseId < m_lastId) : (databaseId > m_lastId);
+    }
+
+    return m_descending ? (value < lastValue) : (value > lastValue);
+}
+
+
+
+/*!
+ * \brief Returns the row a record with \c value and \c databaseId has to be inserted at.
+ *
+ * Performs a binary search on the loaded rows. If \c skipRow is a valid row, that row will be
+ * ignored and the returned position is the position in the list without it.
+ */
+int RecordsModel::insertPosition(double value, int databaseId, int skipRow) const
+{
+    const int count = (skipRow > -1) ? (rowCount() - 1) : rowCount();
+
+    int first = 0;
+    int len = count;
+
+    while (len > 0) {
+        const int half = len / 2;
+        const int mid = first + half;
+        const int row = (skipRow > -1 && mid >= skipRow) ? (mid + 1) : mid;
+        if (sortsBefore(row, value, databaseId)) {
+            first = mid + 1;
+            len = len - half - 1;
         } else {
-            return;
+            len = half;
         }
+    }
 
-        if (m_orderBy == QLatin1String("start")) {
-
-            if (m_order == QLatin1String("DESC")) {
-                beginInsertRows(QModelIndex(), 0, 0);
-                m_records.prepend(record);
-                endInsertRows();
-            } else if (m_order == QLatin1String("ASC")) {
-                beginInsertRows(QModelIndex(), rowCount(), rowCount());
-                m_records.append(record);
-                endInsertRows();
-            } else {
-                update();
-            }
+    return first;
+}
 
-        } else {
-            update();
+
+
+/*!
+ * \brief Updates the cached sort key and direction after \link RecordsModel::order order \endlink
+ * or \link RecordsModel::orderBy orderBy \endlink has been changed.
+ */
+void RecordsModel::updateSortKey()
+{
+    const QString col = sortColumn();
+
+    if (col == QLatin1String("r.duration")) {
+        m_sortKey = SortByDuration;
+    } else if (col == QLatin1String("r.repetitions")) {
+        m_sortKey = SortByRepetitions;
+    } else if (col == QLatin1String("r.distance")) {
+        m_sortKey = SortByDistance;
+    } else {
+        m_sortKey = SortByStart;
+    }
+
+    m_descending = isDescending();
+}
+
+
+
+/*!
+ * \brief Updates the model data after the Record \c record has been changed.
+ *
+ * Patches the affected row and emits dataChanged() only for the changed roles. If the value of the
+ * sort column has been changed, the row will be moved to its new position. If the record does not
+ * match the filter of the model anymore, it will be removed, if it matches now, it will be inserted.
+ */
+void RecordsModel::updated(Record *record)
+{
+    const int id = record->databaseId();
+    const int idx = find(id);
+    const bool accepted = acceptsRecord(record);
+
+    if (idx < 0) {
+        if (accepted) {
+            insertSorted(record);
         }
+        return;
+    }
+
+    if (!accepted) {
+        beginRemoveRows(QModelIndex(), idx, idx);
+        removeRecords(idx, idx);
+        endRemoveRows();
+        return;
+    }
+
+    Activity *a = addActivity(record->activity());
+
+    Record *r = m_items.value(id);
+    if (r && r != record) {
+        r->setActivity(a);
+        r->setStart(record->start());
+        r->setEnd(record->end());
+        r->setDuration(record->duration());
+        r->setRepetitions(record->repetitions());
+        r->setDistance(record->distance());
+        r->setNote(record->note());
+        r->setTpr(record->tpr());
+        r->setMaxSpeed(record->maxSpeed());
+        r->setAvgSpeed(record->avgSpeed());
+    }
+
+    const double oldSortValue = sortValue(idx);
+
+    QVector<int> roles;
+
+    if (m_activityIds.at(idx) != a->databaseId()) {
+        unindexActivity(m_activityIds.at(idx), id);
+        m_activityRecords[a->databaseId()].insert(id);
+        m_activityIds[idx] = a->databaseId();
+        roles << ActivityId << ActivityName << CategoryId << CategoryName << CategoryColor;
+    }
+
+    const qint64 start = record->start().toTime_t();
+    if (m_starts.at(idx) != start) {
+        m_starts[idx] = start;
+        roles << Start;
+    }
+
+    const qint64 end = record->end().toTime_t();
+    if (m_ends.at(idx) != end) {
+        m_ends[idx] = end;
+        roles << End;
+    }
+
+    if (m_durations.at(idx) != record->duration()) {
+        m_durations[idx] = record->duration();
+        roles << Duration;
+    }
+
+    if (m_repetitions.at(idx) != record->repetitions()) {
+        m_repetitions[idx] = record->repetitions();
+        roles << Repetitions;
+    }
+
+    if (m_distances.at(idx) != record->distance()) {
+        m_distances[idx] = record->distance();
+        roles << Distance;
+    }
+
+    const int note = noteIndex(record->note());
+    if (m_noteIndexes.at(idx) != note) {
+        m_noteIndexes[idx] = note;
+        roles << Note;
+    }
+
+    if (m_tprs.at(idx) != record->tpr()) {
+        m_tprs[idx] = record->tpr();
+        roles << Tpr;
+    }
+
+    if (m_maxSpeeds.at(idx) != record->maxSpeed()) {
+        m_maxSpeeds[idx] = record->maxSpeed();
+        roles << MaxSpeed;
+    }
+
+    if (m_avgSpeeds.at(idx) != record->avgSpeed()) {
+        m_avgSpeeds[idx] = record->avgSpeed();
+        roles << AvgSpeed;
+    }
+
+    if (roles.isEmpty()) {
+        return;
+    }
 
+    emit dataChanged(index(idx), index(idx), roles);
+
+    const double newSortValue = sortValue(idx);
+
+    if (newSortValue == oldSortValue) {
+        return;
+    }
+
+    // if the row now sorts behind the loaded pages, it will be loaded again with a later page
+    if (isBehindLoadedPages(newSortValue, id)) {
+        beginRemoveRows(QModelIndex(), idx, idx);
+        removeRecords(idx, idx);
+        endRemoveRows();
+        reloadRunningPage();
+        return;
+    }
+
+    const int pos = insertPosition(newSortValue, id, idx);
+
+    if (pos != idx) {
+        beginMoveRows(QModelIndex(), idx, idx, QModelIndex(), (pos > idx) ? (pos + 1) : pos);
+        moveRecord(idx, pos);
+        endMoveRows();
     }
 }
 
 
+
 /*!
  * \brief Removes the record identified by \c databaseId from the model.
  */
@@ -586,7 +1541,7 @@ void RecordsModel::removed(int databaseId, int activity, int category)
 
     beginRemoveRows(QModelIndex(), idx, idx);
 
-    delete m_records.takeAt(idx);
+    removeRecords(idx, idx);
 
     endRemoveRows();
 }
@@ -607,20 +1562,7 @@ void RecordsModel::removedByActivity(int activity, int category)
         return;
     }
 
-    QList<int> idxs = findByActivity(activity);
-
-    if (idxs.isEmpty()) {
-        return;
-    }
-
-    for (int i = 0; i < idxs.size(); ++i) {
-        int idx = idxs.at(i) - i;
-        beginRemoveRows(QModelIndex(), idx, idx);
-
-        delete m_records.takeAt(idx);
-
-        endRemoveRows();
-    }
+    removeRowList(findByActivity(activity));
 }
 
 
@@ -636,20 +1578,7 @@ void RecordsModel::removedByCategory(int categoryId)
         return;
     }
 
-    QList<int> idxs = findByCategory(categoryId);
-
-    if (idxs.isEmpty()) {
-        return;
-    }
-
-    for (int i = 0; i < idxs.size(); ++i) {
-        int idx = idxs.at(i) - i;
-        beginRemoveRows(QModelIndex(), idx, idx);
-
-        delete m_records.takeAt(idx);
-
-        endRemoveRows();
-    }
+    removeRowList(findByCategory(categoryId));
 }
 
 
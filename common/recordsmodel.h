@@ -22,6 +22,9 @@
 
 #include <QObject>
 #include <QDateTime>
+#include <QVector>
+#include <QStringList>
+#include <QSet>
 #include "dbmodel.h"
 
 namespace Gibrievida {
@@ -30,11 +33,19 @@ class RecordsController;
 class ActivitiesController;
 class CategoriesController;
 class Record;
+class Activity;
 
 /*!
- * \brief Model containig a set of Record objects.
+ * \brief Model containig a set of records.
  *
- * In order to populate the model, you have to call the update() slot.
+ * In order to populate the model, you have to call the update() slot. The model is loaded in pages
+ * of finished records, further pages are requested by the view through canFetchMore() and fetchMore().
+ * Pages are selected via keyset pagination on the current \link RecordsModel::orderBy orderBy \endlink
+ * column and the record ID, so loading a page does not depend on the size of the history.
+ *
+ * The record data is stored column wise in plain value vectors and exposed through the model roles.
+ * Rows reference the canonical activities from the Registry and notes are shared between rows. Record objects are only created on demand through
+ * get() or the \a item role, for example to show or edit a single record.
  */
 class RecordsModel : public DBModel
 {
@@ -46,18 +57,36 @@ class RecordsModel : public DBModel
     Q_PROPERTY(int categoryId READ getCategoryId WRITE setCategoryId)
     Q_PROPERTY(QString order READ getOrder WRITE setOrder NOTIFY orderChanged)
     Q_PROPERTY(QString orderBy READ getOrderBy WRITE setOrderBy NOTIFY orderByChanged)
+    Q_PROPERTY(QString search READ getSearch WRITE setSearch NOTIFY searchChanged)
 public:
     explicit RecordsModel(QObject *parent = nullptr);
     ~RecordsModel();
 
     enum Roles {
-        Item = Qt::UserRole + 1
+        Item = Qt::UserRole + 1,
+        DatabaseId,
+        ActivityId,
+        ActivityName,
+        CategoryId,
+        CategoryName,
+        CategoryColor,
+        Start,
+        End,
+        Duration,
+        Repetitions,
+        Distance,
+        Note,
+        Tpr,
+        MaxSpeed,
+        AvgSpeed
     };
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE Q_DECL_FINAL;
     int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
     QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE Q_DECL_FINAL;
     QModelIndex index(int row, int column = 0, const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE Q_DECL_FINAL;
+    bool canFetchMore(const QModelIndex &parent) const Q_DECL_OVERRIDE Q_DECL_FINAL;
+    void fetchMore(const QModelIndex &parent) Q_DECL_OVERRIDE Q_DECL_FINAL;
 
     void setRecordsController(RecordsController *controller);
     RecordsController *getRecordsController() const;
@@ -80,9 +109,19 @@ public:
     void setOrderBy(const QString &orderBy);
     QString getOrderBy() const;
 
+    void setSearch(const QString &search);
+    QString getSearch() const;
+
+    Q_INVOKABLE Gibrievida::Record *get(int row);
+    Q_INVOKABLE Gibrievida::Record *getByDatabaseId(int databaseId);
+
+    static QStringList sortColumns();
+    static QString pageQuery(const QString &column, bool descending, int activityId, int categoryId, bool search, bool afterCursor);
+
 public slots:
     void update();
     void finished(Record *record);
+    void updated(Record *record);
     void removed(int databaseId, int activity, int category);
     void removedByActivity(int activity, int category);
     void removedByCategory(int categoryId);
@@ -91,9 +130,32 @@ public slots:
 signals:
     void orderChanged(const QString &order);
     void orderByChanged(const QString &orderBy);
+    void searchChanged(const QString &search);
+    /*!
+     * \brief Emitted if the user started the remorse timer to remove the Record identified by \c databaseId.
+     */
+    void removeRequested(int databaseId);
 
 private:
-    QList<Record*> m_records;
+    QVector<int> m_ids;
+    QVector<int> m_activityIds;
+    QVector<qint64> m_starts;
+    QVector<qint64> m_ends;
+    QVector<uint> m_durations;
+    QVector<uint> m_repetitions;
+    QVector<double> m_distances;
+    QVector<int> m_noteIndexes;
+    QVector<float> m_tprs;
+    QVector<float> m_maxSpeeds;
+    QVector<float> m_avgSpeeds;
+
+    QStringList m_notes;
+    QHash<QString, int> m_noteIndex;
+    QHash<int, Activity*> m_activities;
+    mutable QHash<int, Record*> m_items;
+
+    QHash<int, int> m_rows;
+    QHash<int, QSet<int>> m_activityRecords;
 
     RecordsController *m_recsController;
     CategoriesController *m_catsController;
@@ -102,8 +164,49 @@ private:
     int m_categoryId;
     QString m_order;
     QString m_orderBy;
+    QString m_search;
+    QStringList m_searchTerms;
+
+    bool m_canFetchMore;
+    QVariant m_lastKey;
+    int m_lastId;
+
+    enum SortKey {
+        SortByStart,
+        SortByDuration,
+        SortByRepetitions,
+        SortByDistance
+    };
+
+    SortKey m_sortKey;
+    bool m_descending;
 
+    void queryFinished(const DBRows &rows) Q_DECL_OVERRIDE;
     void clear();
+    QString sortColumn() const;
+    bool isDescending() const;
+    void updateSortKey();
+    bool acceptsRecord(Record *record) const;
+    bool matchesSearch(Record *record) const;
+    static QStringList searchTerms(const QString &search);
+    double sortValue(int row) const;
+    double sortValue(Record *record) const;
+    bool sortsBefore(int row, double value, int databaseId) const;
+    bool isBehindLoadedPages(double value, int databaseId) const;
+    void reloadRunningPage();
+    int insertPosition(double value, int databaseId, int skipRow = -1) const;
+
+    Record *item(int row) const;
+    Activity *activity(int row) const;
+    Activity *addActivity(Activity *a);
+    int noteIndex(const QString &note);
+    void insertRecord(int row, Record *r);
+    void removeRecords(int first, int last);
+    void removeRowList(const QList<int> &rows);
+    void moveRecord(int from, int to);
+    void insertSorted(Record *record);
+    void reindex(int row);
+    void unindexActivity(int activity, int databaseId);
 
     int find(int databaseId) const;
     QList<int> findByActivity(int activity) const;
@@ -0,0 +1,206 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "recordwriter.h"
+#include <QTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QGuiApplication>
+#include "record.h"
+#include "globals.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Constructs a new record writer.
+ */
+RecordWriter::RecordWriter(QObject *parent) : BaseController(parent)
+{
+    m_pendingChanges = 0;
+    m_flushCount = 0;
+    m_lastLatency = 0;
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(RECORD_WRITER_FLUSH_INTERVAL);
+    m_timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(m_timer, &QTimer::timeout, this, &RecordWriter::flush);
+
+    QGuiApplication *app = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
+    if (app) {
+        connect(app, &QGuiApplication::applicationStateChanged, this, &RecordWriter::applicationStateChanged);
+    }
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &RecordWriter::flush);
+}
+
+
+/*!
+ * \brief Destroys the record writer and writes pending changes.
+ */
+RecordWriter::~RecordWriter()
+{
+    flush();
+}
+
+
+/*!
+ * \brief Returns the record whose changes are written.
+ */
+Record *RecordWriter::record() const { return m_record.data(); }
+
+
+/*!
+ * \brief Sets the \a record whose changes should be written.
+ *
+ * Pending changes of a previously set record will be discarded, call flush() before if they
+ * should be kept. Set a \c nullptr to stop writing.
+ */
+void RecordWriter::setRecord(Record *record)
+{
+    if (m_record == record) {
+        return;
+    }
+
+    discard();
+
+    if (m_record) {
+        disconnect(m_record.data(), nullptr, this, nullptr);
+    }
+
+    m_record = record;
+
+    if (m_record) {
+        connect(m_record.data(), &Record::repetitionsChanged, this, &RecordWriter::changed);
+        connect(m_record.data(), &Record::distanceChanged, this, &RecordWriter::changed);
+        connect(m_record.data(), &Record::maxSpeedChanged, this, &RecordWriter::changed);
+    }
+}
+
+
+/*!
+ * \brief Returns true if there are changes that have not been written yet.
+ */
+bool RecordWriter::isPending() const
+{
+    return (m_pendingChanges > 0);
+}
+
+
+/*!
+ * \brief Returns the number of UPDATE statements executed by this writer.
+ */
+int RecordWriter::flushCount() const
+{
+    return m_flushCount;
+}
+
+
+/*!
+ * \brief Returns the milliseconds between the first pending change and the end of the last flush.
+ */
+qint64 RecordWriter::lastLatency() const
+{
+    return m_lastLatency;
+}
+
+
+/*!
+ * \brief Collects a change of the record and starts the flush timer if it is not already running.
+ */
+void RecordWriter::changed()
+{
+    if (m_pendingChanges == 0) {
+        m_pendingSince.start();
+    }
+
+    ++m_pendingChanges;
+
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+}
+
+
+/*!
+ * \brief Writes the pending changes if the application is not active anymore.
+ */
+void RecordWriter::applicationStateChanged(Qt::ApplicationState state)
+{
+    if (state != Qt::ApplicationActive) {
+        flush();
+    }
+}
+
+
+/*!
+ * \brief Writes the pending changes of the record to the database.
+ *
+ * Does nothing if there are no pending changes or if the record has not been stored in the database yet.
+ */
+void RecordWriter::flush()
+{
+    m_timer->stop();
+
+    if (m_pendingChanges == 0) {
+        return;
+    }
+
+    if (!m_record || !m_record->isValid()) {
+        m_pendingChanges = 0;
+        return;
+    }
+
+    QSqlQuery *q = prepared(QStringLiteral("records_update_progress"), QStringLiteral("UPDATE records SET repetitions = ?, distance = ?, maxSpeed = ? WHERE id = ?"));
+
+    if (!q) {
+        return;
+    }
+
+    q->addBindValue(m_record->repetitions());
+    q->addBindValue(m_record->distance());
+    q->addBindValue(m_record->maxSpeed());
+    q->addBindValue(m_record->databaseId());
+
+    if (!q->exec()) {
+        qWarning("Failed to write the current record: %s", qUtf8Printable(q->lastError().text()));
+        return;
+    }
+
+    ++m_flushCount;
+    m_lastLatency = m_pendingSince.elapsed();
+
+#ifdef QT_DEBUG
+    qDebug("Wrote %i changes of the current record after %lli ms, %i writes so far.", m_pendingChanges, m_lastLatency, m_flushCount);
+#endif
+
+    m_pendingChanges = 0;
+}
+
+
+/*!
+ * \brief Drops the pending changes without writing them.
+ */
+void RecordWriter::discard()
+{
+    m_timer->stop();
+    m_pendingChanges = 0;
+}
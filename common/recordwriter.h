@@ -0,0 +1,81 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECORDWRITER_H
+#define RECORDWRITER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
+#include "basecontroller.h"
+
+class QTimer;
+
+namespace Gibrievida {
+
+class Record;
+
+/*!
+ * \brief Writes the progress of the active record to the database.
+ *
+ * Changes of repetitions, distance and maximum speed of the record set via setRecord() are
+ * collected and written together in a single UPDATE. The first change after a flush starts
+ * a timer, so the data is written at the latest after RECORD_WRITER_FLUSH_INTERVAL milliseconds,
+ * regardless of how many changes happen in between. The data is also written when the application
+ * becomes inactive or is about to quit.
+ *
+ * The number of flushes and the latency between the first pending change and the last flush can
+ * be queried for measurement.
+ */
+class RecordWriter : public BaseController
+{
+    Q_OBJECT
+public:
+    explicit RecordWriter(QObject *parent = nullptr);
+    ~RecordWriter();
+
+    Record *record() const;
+    void setRecord(Record *record);
+
+    bool isPending() const;
+    int flushCount() const;
+    qint64 lastLatency() const;
+
+public slots:
+    void flush();
+    void discard();
+
+private slots:
+    void changed();
+    void applicationStateChanged(Qt::ApplicationState state);
+
+private:
+    Q_DISABLE_COPY(RecordWriter)
+
+    QPointer<Record> m_record;
+    QTimer *m_timer;
+    QElapsedTimer m_pendingSince;
+    int m_pendingChanges;
+    int m_flushCount;
+    qint64 m_lastLatency;
+};
+
+}
+
+#endif // RECORDWRITER_H
@@ -0,0 +1,504 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "registry.h"
+#include <QCoreApplication>
+#include "category.h"
+#include "activity.h"
+#include "record.h"
+#include "categoriescontroller.h"
+#include "activitiescontroller.h"
+#include "recordscontroller.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+static Registry *s_registry = nullptr;
+
+/*!
+ * \brief Constructs a new empty registry.
+ *
+ * Use instance() to get the registry object.
+ */
+Registry::Registry(QObject *parent) : QObject(parent)
+{
+    m_catsController = nullptr;
+    m_actsController = nullptr;
+    m_recsController = nullptr;
+}
+
+
+/*!
+ * \brief Destroys the registry and all registered objects.
+ */
+Registry::~Registry()
+{
+    s_registry = nullptr;
+}
+
+
+/*!
+ * \brief Returns the global registry object.
+ *
+ * On first call, this will create the registry as child of the application object.
+ * Has to be called from the GUI thread.
+ */
+Registry *Registry::instance()
+{
+    if (!s_registry) {
+        s_registry = new Registry(QCoreApplication::instance());
+    }
+
+    return s_registry;
+}
+
+
+
+/*!
+ * \brief Takes all registered objects out of the lookup tables and emits reloaded().
+ *
+ * Call this after the database has been replaced. The objects are kept as reserve, models might
+ * reference them until they have been reloaded. When the reloaded data contains the same database
+ * ID again, the reserved object is refreshed and registered again instead of creating a new one,
+ * so repeated restores do not create new sets of objects.
+ */
+void Registry::reload()
+{
+    for (Category *c : m_categories) {
+        m_reservedCategories.insert(c->databaseId(), c);
+    }
+    m_categories.clear();
+
+    for (Activity *a : m_activities) {
+        a->resetPersonalBests();
+        m_reservedActivities.insert(a->databaseId(), a);
+    }
+    m_activities.clear();
+
+    emit reloaded();
+}
+
+
+
+/*!
+ * \brief Connects the registry to the controllers to maintain the registered objects and their counters.
+ */
+void Registry::setControllers(CategoriesController *catsController, ActivitiesController *actsController, RecordsController *recsController)
+{
+    if (m_catsController) {
+        m_catsController->disconnect(this);
+    }
+    if (m_actsController) {
+        m_actsController->disconnect(this);
+    }
+    if (m_recsController) {
+        m_recsController->disconnect(this);
+    }
+
+    m_catsController = catsController;
+    m_actsController = actsController;
+    m_recsController = recsController;
+
+    if (m_catsController) {
+        connect(m_catsController, &CategoriesController::added, this, &Registry::categoryAdded);
+        connect(m_catsController, &CategoriesController::updated, this, &Registry::categoryUpdated);
+        connect(m_catsController, &CategoriesController::removed, this, &Registry::categoryRemoved);
+        connect(m_catsController, &CategoriesController::removedAll, this, &Registry::categoriesRemoved);
+    }
+
+    if (m_actsController) {
+        connect(m_actsController, &ActivitiesController::added, this, &Registry::activityAdded);
+        connect(m_actsController, &ActivitiesController::updated, this, &Registry::activityUpdated);
+        connect(m_actsController, &ActivitiesController::removed, this, &Registry::activityRemoved);
+        connect(m_actsController, &ActivitiesController::removedAll, this, &Registry::activitiesRemoved);
+    }
+
+    if (m_recsController) {
+        connect(m_recsController, &RecordsController::finished, this, &Registry::recordFinished);
+        connect(m_recsController, &RecordsController::updated, this, &Registry::recordUpdated);
+        connect(m_recsController, &RecordsController::removed, this, &Registry::recordRemoved);
+        connect(m_recsController, &RecordsController::removedByActivity, this, &Registry::recordsRemovedByActivity);
+        connect(m_recsController, &RecordsController::removedByCategory, this, &Registry::recordsRemovedByCategory);
+        connect(m_recsController, &RecordsController::removedAll, this, &Registry::recordsRemoved);
+    }
+}
+
+
+
+/*!
+ * \brief Returns the registered Category identified by \c databaseId or a \c nullptr if there is none.
+ */
+Category *Registry::category(int databaseId) const
+{
+    return m_categories.value(databaseId);
+}
+
+
+
+/*!
+ * \brief Returns the registered Activity identified by \c databaseId or a \c nullptr if there is none.
+ */
+Activity *Registry::activity(int databaseId) const
+{
+    return m_activities.value(databaseId);
+}
+
+
+
+/*!
+ * \brief Returns the canonical Category for \c databaseId.
+ *
+ * If the category is already registered, its name and color will be updated. The activities count
+ * will only be set if \c activities is not negative.
+ */
+Category *Registry::category(int databaseId, const QString &name, const QString &color, int activities)
+{
+    Category *c = m_categories.value(databaseId);
+
+    if (!c) {
+        c = m_reservedCategories.take(databaseId);
+        if (c) {
+            c->setActivities(qMax(activities, 0));
+            m_categories.insert(databaseId, c);
+        }
+    }
+
+    if (c) {
+        c->setName(name);
+        c->setColor(color);
+        if (activities > -1) {
+            c->setActivities(activities);
+        }
+    } else {
+        c = new Category(databaseId, name, color, qMax(activities, 0), this);
+        m_categories.insert(databaseId, c);
+    }
+
+    return c;
+}
+
+
+
+/*!
+ * \brief Returns the canonical Activity for \c databaseId.
+ *
+ * If the activity is already registered, its data will be updated. The records count will only
+ * be set if \c records is not negative. \c c should be the canonical Category of the activity.
+ */
+Activity *Registry::activity(int databaseId, const QString &name, int minRepeats, int maxRepeats, bool useDistance, int records, int sensorType, int sensorDelay, Category *c)
+{
+    Activity *a = m_activities.value(databaseId);
+
+    if (!a) {
+        a = m_reservedActivities.take(databaseId);
+        if (a) {
+            a->setRecords(qMax(records, 0));
+            m_activities.insert(databaseId, a);
+        }
+    }
+
+    if (a) {
+        a->setName(name);
+        a->setMinRepeats(minRepeats);
+        a->setMaxRepeats(maxRepeats);
+        a->setUseRepeats(minRepeats > 0 && maxRepeats > 0);
+        a->setUseDistance(useDistance);
+        a->setSensorType(sensorType);
+        a->setSensorDelay(sensorDelay);
+        if (records > -1) {
+            a->setRecords(records);
+        }
+    } else {
+        a = new Activity(databaseId, name, minRepeats, maxRepeats, useDistance, qMax(records, 0), sensorType, sensorDelay, this);
+        m_activities.insert(databaseId, a);
+    }
+
+    a->setCategory(c);
+
+    return a;
+}
+
+
+
+/*!
+ * \brief Returns the canonical Category for the data of \c c.
+ *
+ * Returns \c c itself if it is already the canonical object. The activities count of an already
+ * registered category will not be changed.
+ */
+Category *Registry::intern(Category *c)
+{
+    if (!c) {
+        return nullptr;
+    }
+
+    Category *rc = m_categories.value(c->databaseId());
+
+    if (rc == c) {
+        return c;
+    }
+
+    return category(c->databaseId(), c->name(), c->color(), rc ? -1 : c->activities());
+}
+
+
+
+/*!
+ * \brief Returns the canonical Activity for the data of \c a.
+ *
+ * Returns \c a itself if it is already the canonical object. The records count of an already
+ * registered activity will not be changed.
+ */
+Activity *Registry::intern(Activity *a)
+{
+    if (!a) {
+        return nullptr;
+    }
+
+    Activity *ra = m_activities.value(a->databaseId());
+
+    if (ra == a) {
+        return a;
+    }
+
+    return activity(a->databaseId(), a->name(), a->minRepeats(), a->maxRepeats(), a->useDistance(), ra ? -1 : a->records(), a->sensorType(), a->sensorDelay(), intern(a->category()));
+}
+
+
+
+/*!
+ * \brief Registers a newly added category.
+ */
+void Registry::categoryAdded(int databaseId, const QString &name, const QString &color)
+{
+    category(databaseId, name, color, 0);
+}
+
+
+
+/*!
+ * \brief Updates the canonical category after \c c has been updated.
+ */
+void Registry::categoryUpdated(Category *c)
+{
+    intern(c);
+}
+
+
+
+/*!
+ * \brief Unregisters the category identified by \c databaseId and its activities.
+ */
+void Registry::categoryRemoved(int databaseId)
+{
+    m_categories.remove(databaseId);
+
+    QHash<int, Activity*>::iterator i = m_activities.begin();
+    while (i != m_activities.end()) {
+        if (i.value()->category() && i.value()->category()->databaseId() == databaseId) {
+            i = m_activities.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+
+/*!
+ * \brief Unregisters all categories and activities.
+ */
+void Registry::categoriesRemoved()
+{
+    m_categories.clear();
+    m_activities.clear();
+}
+
+
+
+/*!
+ * \brief Registers a newly added activity and increases the activities count of its category.
+ */
+void Registry::activityAdded(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool useDistance, int sensorType, int sensorDelay)
+{
+    Category *cat = intern(c);
+
+    activity(databaseId, name, minRepeats, maxRepeats, useDistance, 0, sensorType, sensorDelay, cat);
+
+    if (cat) {
+        cat->increaseActivities();
+    }
+}
+
+
+
+/*!
+ * \brief Updates the activities count of the categories if the category of \c a has been changed.
+ */
+void Registry::activityUpdated(Activity *a, int oldCategoryId)
+{
+    Activity *ra = intern(a);
+
+    if (ra->category() && ra->category()->databaseId() != oldCategoryId) {
+
+        Category *old = m_categories.value(oldCategoryId);
+
+        if (old) {
+            old->decreaseActivities();
+        }
+
+        ra->category()->increaseActivities();
+    }
+}
+
+
+
+/*!
+ * \brief Unregisters the activity identified by \c databaseId and decreases the activities count of its \c category.
+ */
+void Registry::activityRemoved(int databaseId, int category)
+{
+    m_activities.remove(databaseId);
+
+    Category *c = m_categories.value(category);
+
+    if (c) {
+        c->decreaseActivities();
+    }
+}
+
+
+
+/*!
+ * \brief Unregisters all activities and resets the activities count of all categories.
+ */
+void Registry::activitiesRemoved()
+{
+    m_activities.clear();
+
+    for (Category *c : m_categories) {
+        c->setActivities(0);
+    }
+}
+
+
+
+/*!
+ * \brief Increases the records count of the activity of the finished Record \c r.
+ */
+void Registry::recordFinished(Record *r)
+{
+    if (!r || !r->activity()) {
+        return;
+    }
+
+    Activity *a = m_activities.value(r->activity()->databaseId());
+
+    if (a) {
+        a->setRecords(a->records() + 1);
+    }
+}
+
+
+
+/*!
+ * \brief Updates the records counts of the activities if the activity of Record \c r has been changed.
+ */
+void Registry::recordUpdated(Record *r, int oldActivityId)
+{
+    if (!r || !r->activity() || r->activity()->databaseId() == oldActivityId) {
+        return;
+    }
+
+    Activity *old = m_activities.value(oldActivityId);
+
+    if (old) {
+        old->setRecords(old->records() - 1);
+    }
+
+    Activity *a = m_activities.value(r->activity()->databaseId());
+
+    if (a) {
+        a->setRecords(a->records() + 1);
+    }
+}
+
+
+
+/*!
+ * \brief Decreases the records count of \c activity after a record has been removed.
+ */
+void Registry::recordRemoved(int databaseId, int activity, int category)
+{
+    Q_UNUSED(databaseId)
+    Q_UNUSED(category)
+
+    Activity *a = m_activities.value(activity);
+
+    if (a) {
+        a->setRecords(a->records() - 1);
+    }
+}
+
+
+
+/*!
+ * \brief Resets the records count and the personal bests of \c activity after all its records have been removed.
+ */
+void Registry::recordsRemovedByActivity(int activity, int category)
+{
+    Q_UNUSED(category)
+
+    Activity *a = m_activities.value(activity);
+
+    if (a) {
+        a->setRecords(0);
+        a->setPersonalBests(0.0, 0, 0.0f, 0.0f);
+    }
+}
+
+
+
+/*!
+ * \brief Resets the records count and the personal bests of all activities of \c category.
+ */
+void Registry::recordsRemovedByCategory(int category)
+{
+    for (Activity *a : m_activities) {
+        if (a->category() && a->category()->databaseId() == category) {
+            a->setRecords(0);
+            a->setPersonalBests(0.0, 0, 0.0f, 0.0f);
+        }
+    }
+}
+
+
+
+/*!
+ * \brief Resets the records count and the personal bests of all activities.
+ */
+void Registry::recordsRemoved()
+{
+    for (Activity *a : m_activities) {
+        a->setRecords(0);
+        a->setPersonalBests(0.0, 0, 0.0f, 0.0f);
+    }
+}
@@ -0,0 +1,111 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <QObject>
+#include <QHash>
+
+namespace Gibrievida {
+
+class Category;
+class Activity;
+class Record;
+class CategoriesController;
+class ActivitiesController;
+class RecordsController;
+
+/*!
+ * \brief Process wide registry of the canonical Category and Activity objects.
+ *
+ * There is only one Category and one Activity object per database ID. The models and controllers
+ * get these objects from the registry instead of creating their own copies, so a change to a category
+ * or an activity is visible in every view at once. Interning an existing ID will update the descriptive
+ * data of the existing object and return it.
+ *
+ * The registry also maintains the activities count of the categories and the records count of the
+ * activities. Set the controllers with setControllers() to connect the registry to them.
+ *
+ * Objects of removed categories and activities are taken out of the lookup tables but are kept alive
+ * until the registry gets destroyed, because records or pages might still reference them. After
+ * reload() the objects are reused for the same database IDs.
+ */
+class Registry : public QObject
+{
+    Q_OBJECT
+public:
+    static Registry *instance();
+
+    void setControllers(CategoriesController *catsController, ActivitiesController *actsController, RecordsController *recsController);
+
+    Category *category(int databaseId) const;
+    Activity *activity(int databaseId) const;
+
+    Category *category(int databaseId, const QString &name, const QString &color, int activities = -1);
+    Activity *activity(int databaseId, const QString &name, int minRepeats, int maxRepeats, bool useDistance, int records, int sensorType, int sensorDelay, Category *c);
+
+    Category *intern(Category *c);
+    Activity *intern(Activity *a);
+
+    void reload();
+
+signals:
+    /*!
+     * \brief This signal is emitted after reload() has been called, models and controllers should reload their data.
+     */
+    void reloaded();
+
+private slots:
+    void categoryAdded(int databaseId, const QString &name, const QString &color);
+    void categoryUpdated(Category *c);
+    void categoryRemoved(int databaseId);
+    void categoriesRemoved();
+
+    void activityAdded(int databaseId, const QString &name, Category *c, int minRepeats, int maxRepeats, bool useDistance, int sensorType, int sensorDelay);
+    void activityUpdated(Activity *a, int oldCategoryId);
+    void activityRemoved(int databaseId, int category);
+    void activitiesRemoved();
+
+    void recordFinished(Record *r);
+    void recordUpdated(Record *r, int oldActivityId);
+    void recordRemoved(int databaseId, int activity, int category);
+    void recordsRemovedByActivity(int activity, int category);
+    void recordsRemovedByCategory(int category);
+    void recordsRemoved();
+
+private:
+    explicit Registry(QObject *parent = nullptr);
+    ~Registry();
+
+    QHash<int, Category*> m_categories;
+    QHash<int, Activity*> m_activities;
+    QHash<int, Category*> m_reservedCategories;
+    QHash<int, Activity*> m_reservedActivities;
+
+    CategoriesController *m_catsController;
+    ActivitiesController *m_actsController;
+    RecordsController *m_recsController;
+
+    Q_DISABLE_COPY(Registry)
+};
+
+}
+
+#endif // REGISTRY_H
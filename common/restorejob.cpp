@@ -0,0 +1,180 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "restorejob.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <unistd.h>
+#include "globals.h"
+#include "dbmanager.h"
+#include "backupcompressor.h"
+#include "backupdelta.h"
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+#define RESTOREJOB_CONNECTION_NAME "gibrievida_restore"
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Constructs a new restore job for the backup at \a backupPath and the database at \a databasePath.
+ */
+RestoreJob::RestoreJob(const QString &backupPath, const QString &databasePath, QObject *parent) :
+    QThread(parent), m_backupPath(backupPath), m_tempPath(databasePath + QLatin1String(".restore"))
+{
+
+}
+
+
+/*!
+ * \brief Destroys the restore job.
+ */
+RestoreJob::~RestoreJob()
+{
+
+}
+
+
+/*!
+ * \brief Returns the path of the prepared copy of the backup.
+ */
+QString RestoreJob::tempPath() const
+{
+    return m_tempPath;
+}
+
+
+/*!
+ * \brief The starting point for the thread.
+ */
+void RestoreJob::run()
+{
+#ifdef QT_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    const bool success = prepare();
+
+    if (!success) {
+        QFile::remove(m_tempPath);
+    }
+
+#ifdef QT_DEBUG
+    qDebug("Prepared restore of %s in %lli ms: %s", qUtf8Printable(m_backupPath), timer.elapsed(), success ? "ok" : "failed");
+#endif
+
+    emit done(success);
+}
+
+
+/*!
+ * \brief Copies, decompresses or rebuilds, verifies and upgrades the backup.
+ */
+bool RestoreJob::prepare()
+{
+    QFile::remove(m_tempPath);
+
+    if (BackupDelta::isDelta(m_backupPath)) {
+        if (!BackupDelta::restore(m_backupPath, m_tempPath)) {
+            return false;
+        }
+    } else if (BackupCompressor::isCompressed(m_backupPath)) {
+        if (!BackupCompressor::decompress(m_backupPath, m_tempPath)) {
+            return false;
+        }
+    } else if (!QFile::copy(m_backupPath, m_tempPath)) {
+        qWarning("Failed to copy %s", qUtf8Printable(m_backupPath));
+        return false;
+    }
+
+    if (!verify()) {
+        return false;
+    }
+
+    if (!DBManager::upgrade(m_tempPath)) {
+        return false;
+    }
+
+    // the copy has to be on the disk before it replaces the database
+    QFile f(m_tempPath);
+    if (!f.open(QIODevice::ReadWrite) || ::fsync(f.handle()) != 0) {
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Returns true if the copy is an intact database with a known schema.
+ */
+bool RestoreJob::verify()
+{
+    bool valid = false;
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral(RESTOREJOB_CONNECTION_NAME));
+        db.setDatabaseName(m_tempPath);
+
+        if (db.open()) {
+
+            QSqlQuery q(db);
+
+            if (q.exec(QStringLiteral("PRAGMA integrity_check")) && q.next() && q.value(0).toString() == QLatin1String("ok")) {
+
+                int version = 0;
+                if (q.exec(QStringLiteral("PRAGMA user_version")) && q.next()) {
+                    version = q.value(0).toInt();
+                }
+
+                int tables = 0;
+                if (q.exec(QStringLiteral("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name IN ('categories', 'activities', 'records')")) && q.next()) {
+                    tables = q.value(0).toInt();
+                }
+
+                if (tables != 3) {
+                    qWarning("%s does not contain a Gibrievida database.", qUtf8Printable(m_backupPath));
+                } else if (version > DB_SCHEMA_VERSION) {
+                    qWarning("The schema version %i of %s is not supported.", version, qUtf8Printable(m_backupPath));
+                } else {
+                    valid = true;
+                }
+
+            } else {
+                qWarning("Integrity check of %s failed.", qUtf8Printable(m_backupPath));
+            }
+
+            q.finish();
+            db.close();
+
+        } else {
+            qWarning("Failed to open %s: %s", qUtf8Printable(m_backupPath), qUtf8Printable(db.lastError().text()));
+        }
+    }
+
+    QSqlDatabase::removeDatabase(QStringLiteral(RESTOREJOB_CONNECTION_NAME));
+
+    return valid;
+}
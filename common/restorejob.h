@@ -0,0 +1,67 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESTOREJOB_H
+#define RESTOREJOB_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+
+namespace Gibrievida {
+
+/*!
+ * \brief Prepares the restore of a database backup on its own thread.
+ *
+ * The backup is copied to a temporary file next to the database, compressed backups are decompressed. The copy is checked with
+ * \c PRAGMA \c integrity_check and has to contain a Gibrievida schema that is not newer than
+ * DB_SCHEMA_VERSION. Older schemas are upgraded via DBManager::upgrade(). The live database is
+ * not touched, use tempPath() with DBWorker::replaceDatabase() to put the prepared copy in place.
+ */
+class RestoreJob : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RestoreJob(const QString &backupPath, const QString &databasePath, QObject *parent = nullptr);
+    ~RestoreJob();
+
+    QString tempPath() const;
+
+signals:
+    /*!
+     * \brief This signal is emitted when the copy has been prepared, \a success is false if the backup is not usable.
+     */
+    void done(bool success);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    bool prepare();
+    bool verify();
+
+    QString m_backupPath;
+    QString m_tempPath;
+
+    Q_DISABLE_COPY(RestoreJob)
+};
+
+}
+
+#endif // RESTOREJOB_H
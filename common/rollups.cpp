@@ -0,0 +1,227 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rollups.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QStringBuilder>
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+static const Rollups::Period rollupPeriods[] = {Rollups::Day, Rollups::Week, Rollups::Month};
+
+/*!
+ * \brief Returns the name of the rollup table for \a period.
+ */
+QString Rollups::table(Period period)
+{
+    switch (period) {
+    case Week:
+        return QStringLiteral("rollups_weekly");
+    case Month:
+        return QStringLiteral("rollups_monthly");
+    default:
+        return QStringLiteral("rollups_daily");
+    }
+}
+
+
+/*!
+ * \brief Returns an SQL expression for the \a period that contains the unix time in \a timeColumn.
+ *
+ * The result is the local date of the first day of the period in the format \c YYYY-MM-DD.
+ */
+QString Rollups::periodExpression(Period period, const QString &timeColumn)
+{
+    switch (period) {
+    case Week:
+        return QStringLiteral("date(%1, 'unixepoch', 'localtime', '-6 days', 'weekday 1')").arg(timeColumn);
+    case Month:
+        return QStringLiteral("date(%1, 'unixepoch', 'localtime', 'start of month')").arg(timeColumn);
+    default:
+        return QStringLiteral("date(%1, 'unixepoch', 'localtime')").arg(timeColumn);
+    }
+}
+
+
+/*!
+ * \brief Returns the date modifier that moves the first day of a \a period to the first day of the next one.
+ */
+QString Rollups::nextPeriodModifier(Period period)
+{
+    switch (period) {
+    case Week:
+        return QStringLiteral("+7 days");
+    case Month:
+        return QStringLiteral("+1 month");
+    default:
+        return QStringLiteral("+1 day");
+    }
+}
+
+
+/*!
+ * \brief Returns the statements that create the rollup tables, their indexes and triggers.
+ */
+QStringList Rollups::schema()
+{
+    QStringList statements;
+
+    QString addAll;
+    QString subtractAll;
+
+    for (Period period : rollupPeriods) {
+        const QString t = table(period);
+        statements << QStringLiteral("CREATE TABLE IF NOT EXISTS ") % t % QStringLiteral(" "
+                                     "(activity INTEGER NOT NULL, "
+                                     "period TEXT NOT NULL, "
+                                     "count INTEGER NOT NULL DEFAULT 0, "
+                                     "duration INTEGER NOT NULL DEFAULT 0, "
+                                     "repetitions INTEGER NOT NULL DEFAULT 0, "
+                                     "distance REAL NOT NULL DEFAULT 0.0, "
+                                     "max_speed REAL NOT NULL DEFAULT 0.0, "
+                                     "PRIMARY KEY (activity, period), "
+                                     "FOREIGN KEY(activity) REFERENCES activities(id) ON DELETE CASCADE) WITHOUT ROWID");
+        statements << QStringLiteral("CREATE INDEX IF NOT EXISTS idx_") % t % QStringLiteral("_period ON ") % t % QStringLiteral(" (period)");
+        addAll.append(addStatements(period, QStringLiteral("NEW")));
+        subtractAll.append(subtractStatements(period, QStringLiteral("OLD")));
+    }
+
+    // the progress of the active record does not touch the rollups, they only contain finished records
+    const QString columns = QStringLiteral("activity, start, end, duration, repetitions, distance, maxSpeed");
+
+    statements << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_rollups_insert AFTER INSERT ON records WHEN NEW.end > 0 BEGIN ") % addAll % QStringLiteral("END");
+    statements << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_rollups_delete AFTER DELETE ON records WHEN OLD.end > 0 BEGIN ") % subtractAll % QStringLiteral("END");
+    statements << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_rollups_update_old AFTER UPDATE OF ") % columns % QStringLiteral(" ON records WHEN OLD.end > 0 BEGIN ") % subtractAll % QStringLiteral("END");
+    statements << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_rollups_update_new AFTER UPDATE OF ") % columns % QStringLiteral(" ON records WHEN NEW.end > 0 BEGIN ") % addAll % QStringLiteral("END");
+
+    return statements;
+}
+
+
+/*!
+ * \brief Returns the trigger statements that add the record \a row (NEW or OLD) to the rollup of \a period.
+ */
+QString Rollups::addStatements(Period period, const QString &row)
+{
+    const QString t = table(period);
+    const QString p = periodExpression(period, row % QStringLiteral(".start"));
+
+    return QStringLiteral("INSERT OR IGNORE INTO %1 (activity, period) VALUES (%2.activity, %3); "
+                          "UPDATE %1 SET count = count + 1, duration = duration + %2.duration, "
+                          "repetitions = repetitions + IFNULL(%2.repetitions, 0), distance = distance + IFNULL(%2.distance, 0.0), "
+                          "max_speed = MAX(max_speed, IFNULL(%2.maxSpeed, 0.0)) "
+                          "WHERE activity = %2.activity AND period = %3; ").arg(t, row, p);
+}
+
+
+/*!
+ * \brief Returns the trigger statements that remove the record \a row (NEW or OLD) from the rollup of \a period.
+ *
+ * The maximum speed can not be subtracted, it is recalculated from the remaining records of the period.
+ * Rows without records are removed.
+ */
+QString Rollups::subtractStatements(Period period, const QString &row)
+{
+    const QString t = table(period);
+    const QString p = periodExpression(period, row % QStringLiteral(".start"));
+
+    return QStringLiteral("UPDATE %1 SET count = count - 1, duration = duration - %2.duration, "
+                          "repetitions = repetitions - IFNULL(%2.repetitions, 0), distance = distance - IFNULL(%2.distance, 0.0), "
+                          "max_speed = (SELECT IFNULL(MAX(maxSpeed), 0.0) FROM records WHERE activity = %2.activity AND end > 0 "
+                          "AND start >= CAST(strftime('%s', %1.period, 'utc') AS INTEGER) "
+                          "AND start < CAST(strftime('%s', %1.period, '%4', 'utc') AS INTEGER)) "
+                          "WHERE activity = %2.activity AND period = %3; "
+                          "DELETE FROM %1 WHERE activity = %2.activity AND period = %3 AND count <= 0; ").arg(t, row, p, nextPeriodModifier(period));
+}
+
+
+/*!
+ * \brief Returns a query that calculates the rollup of \a period from the records table.
+ */
+QString Rollups::aggregateQuery(Period period)
+{
+    return QStringLiteral("SELECT activity, %1 AS period, COUNT(*) AS count, SUM(duration) AS duration, SUM(IFNULL(repetitions, 0)) AS repetitions, "
+                          "SUM(IFNULL(distance, 0.0)) AS distance, MAX(IFNULL(maxSpeed, 0.0)) AS max_speed "
+                          "FROM records WHERE end > 0 GROUP BY activity, period").arg(periodExpression(period, QStringLiteral("start")));
+}
+
+
+/*!
+ * \brief Recreates the content of all rollup tables from the records table.
+ *
+ * Should be executed inside a transaction. Returns false if one of the statements failed.
+ */
+bool Rollups::rebuild(QSqlQuery &q)
+{
+    for (Period period : rollupPeriods) {
+
+        const QString t = table(period);
+
+        if (!q.exec(QStringLiteral("DELETE FROM ") % t)) {
+            qWarning("Failed to clear %s: %s", qUtf8Printable(t), qUtf8Printable(q.lastError().text()));
+            return false;
+        }
+
+        if (!q.exec(QStringLiteral("INSERT INTO ") % t % QStringLiteral(" (activity, period, count, duration, repetitions, distance, max_speed) ") % aggregateQuery(period))) {
+            qWarning("Failed to rebuild %s: %s", qUtf8Printable(t), qUtf8Printable(q.lastError().text()));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * \brief Returns true if the rollup tables match the content of the records table.
+ *
+ * Distances and speeds are compared with a precision of three decimal places, as the incrementally
+ * calculated sums can differ in the last bits.
+ */
+bool Rollups::check(QSqlQuery &q)
+{
+    bool consistent = true;
+
+    for (Period period : rollupPeriods) {
+
+        const QString columns = QStringLiteral("SELECT activity, period, count, duration, repetitions, ROUND(distance, 3), ROUND(max_speed, 3) FROM ");
+        const QString stored = columns % table(period);
+        const QString expected = columns % QLatin1Char('(') % aggregateQuery(period) % QLatin1Char(')');
+
+        if (!q.exec(QStringLiteral("SELECT (SELECT COUNT(*) FROM (") % stored % QStringLiteral(" EXCEPT ") % expected % QStringLiteral(")), "
+                                   "(SELECT COUNT(*) FROM (") % expected % QStringLiteral(" EXCEPT ") % stored % QStringLiteral("))")) || !q.next()) {
+            qWarning("Failed to check %s: %s", qUtf8Printable(table(period)), qUtf8Printable(q.lastError().text()));
+            return false;
+        }
+
+        const int differences = q.value(0).toInt() + q.value(1).toInt();
+
+        if (differences > 0) {
+            qWarning("%s differs from the records in %i rows.", qUtf8Printable(table(period)), differences);
+            consistent = false;
+        }
+    }
+
+    return consistent;
+}
@@ -0,0 +1,70 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ROLLUPS_H
+#define ROLLUPS_H
+
+#include <QString>
+#include <QStringList>
+
+class QSqlQuery;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Maintains the daily, weekly and monthly rollup tables of the finished records.
+ *
+ * The tables rollups_daily, rollups_weekly and rollups_monthly contain one row per activity and period
+ * with the number of finished records, the total duration, repetitions and distance and the maximum
+ * speed. Periods are identified by the local date of their first day, weeks start on Monday.
+ *
+ * The tables are kept up to date by triggers on the records table, so finishing, updating and removing
+ * records through the RecordsController changes only the affected rows. rebuild() recreates the content
+ * from the records table, check() compares both.
+ */
+class Rollups
+{
+public:
+    /*!
+     * \brief The rollup periods.
+     */
+    enum Period {
+        Day,    /**< One row per activity and day. */
+        Week,   /**< One row per activity and week. */
+        Month   /**< One row per activity and month. */
+    };
+
+    static QString table(Period period);
+    static QString periodExpression(Period period, const QString &timeColumn);
+    static QStringList schema();
+    static bool rebuild(QSqlQuery &q);
+    static bool check(QSqlQuery &q);
+
+private:
+    Rollups();
+
+    static QString nextPeriodModifier(Period period);
+    static QString addStatements(Period period, const QString &row);
+    static QString subtractStatements(Period period, const QString &row);
+    static QString aggregateQuery(Period period);
+};
+
+}
+
+#endif // ROLLUPS_H
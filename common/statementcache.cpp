@@ -0,0 +1,156 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "statementcache.h"
+#include "globals.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#ifdef QT_DEBUG
+#include <QtDebug>
+#endif
+
+using namespace Gibrievida;
+
+struct CachedStatement {
+    QString sql;
+    QSqlQuery *query = nullptr;
+    quint64 lastUse = 0;
+};
+
+struct ConnectionStatements {
+    QHash<QString, CachedStatement> statements;
+    quint64 uses = 0;
+    int hits = 0;
+    int misses = 0;
+};
+
+static QMutex s_statementsMutex;
+static QHash<QString, ConnectionStatements> s_connections;
+static QAtomicInt s_hits;
+static QAtomicInt s_misses;
+
+
+/*!
+ * \brief Returns the prepared statement identified by \c id for the connection \c db.
+ *
+ * If there is no cached statement for \c id, or if the cached statement has another \c sql,
+ * a new query will be prepared from \c sql and cached. Returns a \c nullptr if the statement
+ * could not be prepared. The returned query is owned by the cache, call QSqlQuery::finish() after
+ * reading the results of a SELECT statement. The query is only valid until the next statement is
+ * prepared for the same connection, as that might remove it from a full cache.
+ */
+QSqlQuery *StatementCache::prepare(const QSqlDatabase &db, const QString &id, const QString &sql, bool forwardOnly)
+{
+    const QString connection = db.connectionName();
+
+    {
+        QMutexLocker locker(&s_statementsMutex);
+        ConnectionStatements &cs = s_connections[connection];
+        auto it = cs.statements.find(id);
+        if (it != cs.statements.end() && it->query && it->sql == sql) {
+            it->lastUse = ++cs.uses;
+            ++cs.hits;
+            s_hits.fetchAndAddRelaxed(1);
+            return it->query;
+        }
+        ++cs.misses;
+    }
+
+    s_misses.fetchAndAddRelaxed(1);
+
+    QSqlQuery *q = new QSqlQuery(db);
+    q->setForwardOnly(forwardOnly);
+
+    if (!q->prepare(sql)) {
+        qWarning("Failed to prepare statement %s: %s", qUtf8Printable(id), qUtf8Printable(q->lastError().text()));
+        delete q;
+        return nullptr;
+    }
+
+    QMutexLocker locker(&s_statementsMutex);
+    ConnectionStatements &cs = s_connections[connection];
+
+    if (!cs.statements.contains(id) && cs.statements.size() >= STATEMENT_CACHE_SIZE) {
+        auto oldest = cs.statements.begin();
+        for (auto it = cs.statements.begin(); it != cs.statements.end(); ++it) {
+            if (it->lastUse < oldest->lastUse) {
+                oldest = it;
+            }
+        }
+        delete oldest->query;
+        cs.statements.erase(oldest);
+    }
+
+    CachedStatement &st = cs.statements[id];
+    delete st.query;
+    st.sql = sql;
+    st.query = q;
+    st.lastUse = ++cs.uses;
+
+    return q;
+}
+
+
+
+/*!
+ * \brief Removes all cached statements of the connection \c connectionName.
+ *
+ * Logs the number of cache hits and misses of the connection.
+ */
+void StatementCache::clear(const QString &connectionName)
+{
+    QMutexLocker locker(&s_statementsMutex);
+
+    const ConnectionStatements cs = s_connections.take(connectionName);
+
+#ifdef QT_DEBUG
+    if (cs.hits > 0 || cs.misses > 0) {
+        qDebug("Statement cache of connection %s: %i hits, %i misses", qUtf8Printable(connectionName), cs.hits, cs.misses);
+    }
+#endif
+
+    for (const CachedStatement &st : cs.statements) {
+        delete st.query;
+    }
+}
+
+
+
+/*!
+ * \brief Returns the number of statements that have been taken from the cache by all connections.
+ */
+int StatementCache::hits()
+{
+    return s_hits.load();
+}
+
+
+
+/*!
+ * \brief Returns the number of statements that had to be prepared by all connections.
+ */
+int StatementCache::misses()
+{
+    return s_misses.load();
+}
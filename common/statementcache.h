@@ -0,0 +1,56 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QString>
+
+class QSqlQuery;
+class QSqlDatabase;
+
+namespace Gibrievida {
+
+/*!
+ * \brief Process wide cache of prepared SQL statements.
+ *
+ * Statements are cached per database connection and identified by a statement ID. A statement is
+ * prepared on first use and only rebound and executed on later calls. Cached statements must only be used
+ * in the thread of their connection. Call clear() before a connection gets closed or removed.
+ *
+ * Every connection keeps at most STATEMENT_CACHE_SIZE statements, the least recently used one is removed
+ * when a new statement has to be added to a full cache. The number of cache hits and misses is counted per
+ * connection and logged by clear(), the totals of all connections are available via hits() and misses().
+ */
+class StatementCache
+{
+public:
+    static QSqlQuery *prepare(const QSqlDatabase &db, const QString &id, const QString &sql, bool forwardOnly = true);
+    static void clear(const QString &connectionName);
+
+    static int hits();
+    static int misses();
+
+private:
+    StatementCache();
+};
+
+}
+
+#endif // STATEMENTCACHE_H
@@ -286,9 +286,7 @@ Dialog {
             activity.minRepeats = parseInt(minRepeatsField.text)
             activity.maxRepeats = parseInt(maxRepeatsField.text)
             activity.useDistance = distanceSwitch.checked
-            activity.category.databaseId = categoryButton.chosenCategory.databaseId
-            activity.category.name = categoryButton.chosenCategory.name
-            activity.category.color = categoryButton.chosenCategory.color
+            activity.category = categoryButton.chosenCategory
             activity.sensorType = sensorChoser.currentIndex
             activity.sensorDelay = parseInt(sensorDelayField.text)
             activities.update(activity, oldCategoryId)
@@ -169,6 +169,11 @@ Page {
                         }
                     }
 
+                    MenuItem {
+                        text: qsTr("Statistics")
+                        onClicked: pageStack.push(Qt.resolvedUrl("Statistics.qml"), {activity: model.item})
+                    }
+
                     MenuItem {
                         text: qsTr("Edit")
                         onClicked: pageStack.push(Qt.resolvedUrl("../dialogs/ActivityDialog.qml"), {activity: model.item})
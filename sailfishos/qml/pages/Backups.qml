@@ -34,6 +34,18 @@ Page {
                 onClicked: remorse.execute(qsTr("Deleting all"), function() {backupModel.removeAll()})
             }
 
+            MenuItem {
+                text: qsTr("Create incremental")
+                onClicked: backupModel.createIncremental()
+                enabled: !backupModel.inOperation
+            }
+
+            MenuItem {
+                text: qsTr("Create compressed")
+                onClicked: backupModel.create(true)
+                enabled: !backupModel.inOperation
+            }
+
             MenuItem {
                 text: qsTr("Create")
                 onClicked: backupModel.create()
@@ -52,7 +64,7 @@ Page {
         delegate: ListItem {
             id: backupListItem
             width: parent.width
-            contentHeight: Theme.itemSizeMedium
+            contentHeight: Math.max(Theme.itemSizeMedium, backupListItemCol.height + 2 * Theme.paddingSmall)
             menu: contextMenu
 
             ListView.onRemove: animateRemoval(backupListItem)
@@ -99,6 +111,25 @@ Page {
                     text: size
                     font.pixelSize: Theme.fontSizeSmall
                 }
+
+                Text {
+                    width: parent.width
+                    visible: hasMetadata
+                    color: backupListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                    //: backup list entry content, %n is the number of records, %1 the number of activities
+                    text: valid ? qsTr("%n record(s)", "", records) + " · " + qsTr("%n activity(s)", "", activities) : qsTr("Unreadable backup")
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    wrapMode: Text.WordWrap
+                }
+
+                Text {
+                    width: parent.width
+                    visible: hasMetadata && valid && records > 0
+                    color: backupListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                    //: backup list entry date range of the records, %1 is the first, %2 the last date
+                    text: qsTr("%1 – %2").arg(Qt.formatDate(firstRecord, Qt.DefaultLocaleShortDate)).arg(Qt.formatDate(lastRecord, Qt.DefaultLocaleShortDate))
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                }
             }
 
             Component {
@@ -125,6 +125,11 @@ Page {
             Component {
                 id: contextMenu
                 ContextMenu {
+                    MenuItem {
+                        text: qsTr("Statistics")
+                        onClicked: pageStack.push(Qt.resolvedUrl("Statistics.qml"), {category: item})
+                    }
+
                     MenuItem {
                         text: qsTr("Edit")
                         onClicked: pageStack.push(Qt.resolvedUrl("../dialogs/CategoryDialog.qml"), {category: item})
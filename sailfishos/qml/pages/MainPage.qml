@@ -61,6 +61,15 @@ Page {
                 title: "Gibrievida"
             }
 
+            ProgressBar {
+                width: parent.width
+                visible: migration.running
+                minimumValue: 0
+                maximumValue: 100
+                value: migration.progress
+                label: qsTr("Updating database")
+            }
+
             SectionHeader {
                 text: qsTr("Current record")
             }
@@ -88,6 +88,39 @@ Page {
                 title: record ? record.activity.name : ""
             }
 
+            IconSectionHeader {
+                icon: "image://theme/icon-s-favorite"
+                text: qsTr("New personal bests")
+                visible: record ? record.newPersonalBests !== Record.NoPersonalBest : false
+            }
+
+            Text {
+                width: parent.width
+                color: Theme.highlightColor
+                font.pixelSize: Theme.fontSizeSmall
+                wrapMode: Text.WrapAtWordBoundaryOrAnywhere
+                visible: record ? record.newPersonalBests !== Record.NoPersonalBest : false
+                text: {
+                    if (!record) {
+                        return ""
+                    }
+                    var bests = []
+                    if (record.newPersonalBests & Record.DistancePersonalBest) {
+                        bests.push(qsTr("Longest distance"))
+                    }
+                    if (record.newPersonalBests & Record.RepetitionsPersonalBest) {
+                        bests.push(qsTr("Most repetitions"))
+                    }
+                    if (record.newPersonalBests & Record.TprPersonalBest) {
+                        bests.push(qsTr("Fastest time per repetition"))
+                    }
+                    if (record.newPersonalBests & Record.SpeedPersonalBest) {
+                        bests.push(qsTr("Top speed"))
+                    }
+                    return bests.join(", ")
+                }
+            }
+
             IconSectionHeader {
                 icon: "image://theme/icon-s-time"
                 text: qsTr("Start time")
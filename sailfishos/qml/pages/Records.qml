@@ -84,10 +84,28 @@ Page {
             categoriesController: categories
         }
 
-        header: PageHeader {
-            title: qsTr("Records")
-            page: recordsManager
-            description: category ? category.name : activity ? activity.name : qsTr("All")
+        header: Column {
+            width: recordsListView.width
+
+            PageHeader {
+                title: qsTr("Records")
+                page: recordsManager
+                description: category ? category.name : activity ? activity.name : qsTr("All")
+            }
+
+            SearchField {
+                id: searchField
+                width: parent.width
+                placeholderText: qsTr("Search notes and activities")
+                EnterKey.iconSource: "image://theme/icon-m-enter-close"
+                EnterKey.onClicked: searchField.focus = false
+
+                Binding {
+                    target: recordsModel
+                    property: "search"
+                    value: searchField.text.trim()
+                }
+            }
         }
 
         BusyIndicator {
@@ -106,15 +124,22 @@ Page {
             ListView.onAdd: AddAnimation { target: recManagerListItem }
             ListView.onRemove: animateRemoval(recManagerListItem)
 
-            onClicked: pageStack.push(Qt.resolvedUrl("Record.qml"), {record: model.item, comingFromList: true})
+            onClicked: pageStack.push(Qt.resolvedUrl("Record.qml"), {record: recordsModel.get(index), comingFromList: true})
 
             Connections {
-                target: model.item
-                onStartRemoving: recManagerListItem.remove()
+                target: recordsModel
+                onRemoveRequested: if (databaseId === model.databaseId) { recManagerListItem.remove() }
             }
 
             function remove() {
-                remorseAction(qsTr("Removing"), function() {records.remove(model.item)})
+                var databaseId = model.databaseId
+                // the row might have been changed or removed while the remorse timer was running
+                remorseAction(qsTr("Removing"), function() {
+                    var r = recordsModel.getByDatabaseId(databaseId)
+                    if (r) {
+                        records.remove(r)
+                    }
+                })
             }
 
             Rectangle {
@@ -122,7 +147,7 @@ Page {
                 anchors { left: parent.left; leftMargin: Theme.paddingSmall; top: parent.top; verticalCenter: parent.verticalCenter }
                 width: Theme.itemSizeExtraSmall/5
                 height: Theme.itemSizeSmall * 0.9
-                color: item.activity.category.color
+                color: model.categoryColor
             }
 
             Column {
@@ -134,7 +159,7 @@ Page {
                     Label {
                         id: aName
                         width: parent.width*0.6
-                        text: item.activity.name
+                        text: model.activityName
                         color: recManagerListItem.highlighted ? Theme.highlightColor : Theme.primaryColor
                         truncationMode: TruncationMode.Fade
                     }
@@ -143,7 +168,7 @@ Page {
                         id: timeText
                         width: parent.width*0.4
                         anchors { verticalCenter: aName.verticalCenter }
-                        text: helpers.relativeTimeString(item.start)
+                        text: helpers.relativeTimeString(model.start)
                         font.pixelSize: Theme.fontSizeExtraSmall
                         color: recManagerListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
                         horizontalAlignment: Text.AlignRight
@@ -156,7 +181,7 @@ Page {
                     Text {
                         id: cName
                         width: parent.width * 0.33
-                        text: item.activity.category.name
+                        text: model.categoryName
                         font.pixelSize: Theme.fontSizeExtraSmall
                         color: recManagerListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
                         elide: Text.ElideRight
@@ -177,7 +202,7 @@ Page {
                         Text {
                             id: durText
                             anchors { left: durIcon.right; leftMargin: Theme.paddingSmall }
-                            text: helpers.createDurationString(item.duration)
+                            text: helpers.createDurationString(model.duration)
                             font.pixelSize: Theme.fontSizeExtraSmall
                             color: recManagerListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
                         }
@@ -187,7 +212,7 @@ Page {
                         id: repetitionItem
                         width: distanceItem.visible ? (parent.width * 0.17) : (parent.width * 0.34)
                         height: repText.height
-                        visible: item.repetitions > 0
+                        visible: model.repetitions > 0
 
                         ImageHighlight {
                             id: repIcon
@@ -200,7 +225,7 @@ Page {
                         Text {
                             id: repText
                             anchors { left: repIcon.right; leftMargin: Theme.paddingSmall; top: parent.top }
-                            text: item.repetitions
+                            text: model.repetitions
                             font.pixelSize: Theme.fontSizeExtraSmall
                             color: recManagerListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
                         }
@@ -210,7 +235,7 @@ Page {
                         id: distanceItem
                         width: repetitionItem.visible ? (parent.width * 0.17) : (parent.width * 0.34)
                         height: distText.height
-                        visible: item.distance > 0.0
+                        visible: model.distance > 0.0
 
                         ImageHighlight {
                             id: distIcon
@@ -223,7 +248,7 @@ Page {
                         Text {
                             id: distText
                             anchors { left: distIcon.right; leftMargin: Theme.paddingSmall; top: parent.top }
-                            text: helpers.toDistanceString(item.distance)
+                            text: helpers.toDistanceString(model.distance)
                             font.pixelSize: Theme.fontSizeExtraSmall
                             color: recManagerListItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
                         }
@@ -236,7 +261,7 @@ Page {
                 ContextMenu {
                     MenuItem {
                         text: qsTr("Edit")
-                        onClicked: pageStack.push(Qt.resolvedUrl("../dialogs/RecordDialog.qml"), {record: model.item})
+                        onClicked: pageStack.push(Qt.resolvedUrl("../dialogs/RecordDialog.qml"), {record: recordsModel.get(index)})
                     }
                     MenuItem {
                         text: qsTr("Remove")
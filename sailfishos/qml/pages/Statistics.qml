@@ -0,0 +1,135 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+import harbour.gibrievida 1.0
+import "../common"
+
+Page {
+    id: statisticsPage
+
+    property Activity activity: null
+    property Category category: null
+
+    Component.onCompleted: {
+        if (activity) {
+            statisticsModel.activityId = activity.databaseId
+        } else if (category) {
+            statisticsModel.categoryId = category.databaseId
+        }
+
+        statisticsModel.update()
+    }
+
+    function valueString(metric, value) {
+        if (value === undefined || value === null) {
+            return "–"
+        }
+
+        switch (metric) {
+        case ActivityStatisticsModel.Duration:
+            return helpers.createDurationString(Math.round(value))
+        case ActivityStatisticsModel.Distance:
+            return helpers.toDistanceString(value)
+        case ActivityStatisticsModel.Speed:
+            return helpers.toSpeedString(value)
+        case ActivityStatisticsModel.Tpr:
+            //: time per repetition in seconds
+            return qsTr("%1 s").arg(Number(value).toLocaleString(Qt.locale(), 'f', 1))
+        default:
+            return Number(value).toLocaleString(Qt.locale(), 'f', value % 1 === 0 ? 0 : 1)
+        }
+    }
+
+    ActivityStatisticsModel {
+        id: statisticsModel
+        recordsController: records
+    }
+
+    SilicaListView {
+        id: statisticsListView
+        anchors.fill: parent
+
+        VerticalScrollDecorator { page: statisticsPage; flickable: statisticsListView }
+
+        header: Column {
+            width: statisticsListView.width
+
+            PageHeader {
+                title: qsTr("Statistics")
+                page: statisticsPage
+                description: activity ? activity.name : category ? category.name : qsTr("All")
+            }
+
+            ComboBox {
+                width: parent.width
+                label: qsTr("Time window")
+                currentIndex: statisticsModel.window
+                menu: ContextMenu {
+                    MenuItem { text: qsTr("All time") }
+                    MenuItem { text: qsTr("Last 7 days") }
+                    MenuItem { text: qsTr("Last 30 days") }
+                    MenuItem { text: qsTr("Last 365 days") }
+                }
+                onCurrentIndexChanged: statisticsModel.window = currentIndex
+            }
+
+            DetailItem {
+                label: qsTr("Records")
+                value: statisticsModel.count
+            }
+        }
+
+        model: statisticsModel
+
+        delegate: Column {
+            width: statisticsListView.width
+            visible: model.best !== undefined && model.best !== null
+            height: visible ? implicitHeight : 0
+
+            SectionHeader {
+                text: [qsTr("Duration"), qsTr("Repetitions"), qsTr("Distance"), qsTr("Time per repetition"), qsTr("Speed")][model.metric]
+            }
+
+            DetailItem {
+                label: qsTr("Total")
+                value: valueString(model.metric, model.total)
+                visible: model.total !== undefined && model.total !== null
+            }
+
+            DetailItem {
+                label: qsTr("Average")
+                value: valueString(model.metric, model.average)
+            }
+
+            DetailItem {
+                label: qsTr("Best")
+                value: valueString(model.metric, model.best)
+            }
+        }
+
+        BusyIndicator {
+            size: BusyIndicatorSize.Large
+            anchors.centerIn: parent
+            running: visible
+            visible: statisticsModel.inOperation
+        }
+    }
+}
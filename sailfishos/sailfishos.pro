@@ -18,6 +18,9 @@ CONFIG += c++14
 
 QT += sql multimedia sensors positioning
 
+CONFIG += link_pkgconfig
+PKGCONFIG += sqlite3 zlib
+
 DEFINES += GIBRIEVIDA_VERSION=\"\\\"$${VERSION}\\\"\"
 
 CONFIG(release, debug|release) {
@@ -69,6 +72,7 @@ DISTFILES += \
     qml/pages/AttachedFilters.qml \
     qml/pages/Help.qml \
     qml/pages/Backups.qml \
+    qml/pages/Statistics.qml \
     qml/cover/CoverPage.qml
 
 include(../HBN_SFOS_Components/HBN_SFOS_Components.pri)
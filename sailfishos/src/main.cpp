@@ -25,12 +25,15 @@
 #include <QtDebug>
 #include <QFile>
 #include <QTextStream>
+#include <QElapsedTimer>
 #endif
 
 #include <QtQml>
 #include <QGuiApplication>
 #include <QQuickView>
 #include <QTranslator>
+#include <QSqlDatabase>
+#include <memory>
 
 #ifndef CLAZY
 #include <sailfishapp.h>
@@ -56,6 +59,11 @@
 #include "../common/configuration.h"
 #include "../common/backupmodel.h"
 #include "../common/distancemeasurement.h"
+#include "../common/registry.h"
+#include "../common/activitystatisticsmodel.h"
+#include "../common/connectionpool.h"
+#include "../common/queryplancheck.h"
+#include "../common/migrationstatus.h"
 
 
 #ifdef QT_DEBUG
@@ -101,6 +109,11 @@ void gibrievidaMessageHandler(QtMsgType type, const QMessageLogContext &context,
 
 int main(int argc, char *argv[])
 {
+#ifdef QT_DEBUG
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+#endif
+
 #ifndef CLAZY
     std::unique_ptr<QGuiApplication> app(SailfishApp::application(argc, argv));
 #else
@@ -116,9 +129,30 @@ int main(int argc, char *argv[])
     qInstallMessageHandler(gibrievidaMessageHandler);
 #endif
 
+    // the schema check runs while the QML engine is set up, database consumers wait for DBManager::ready()
     Gibrievida::DBManager *dbm = new Gibrievida::DBManager();
     QObject::connect(dbm, &QThread::finished, dbm, &QObject::deleteLater);
-    dbm->start(QThread::LowPriority);
+    // the upgrade steps run before ready(), their progress is shown on the main page
+    Gibrievida::MigrationStatus *migration = new Gibrievida::MigrationStatus(dbm, app.get());
+#ifdef QT_DEBUG
+    QObject::connect(dbm, &Gibrievida::DBManager::ready, app.get(), [&startupTimer] () {
+        qDebug("Database ready after %lli ms", startupTimer.elapsed());
+    });
+#endif
+    dbm->start();
+
+    // checks the query plans on the local database and exits with a non-zero status if a check failed
+    if (app->arguments().contains(QStringLiteral("--check-query-plans"))) {
+        Gibrievida::DBManager::whenReady(app.get(), [&app] () {
+            QSqlDatabase db = Gibrievida::ConnectionPool::database();
+            if (!db.isOpen()) {
+                app->exit(2);
+                return;
+            }
+            app->exit(Gibrievida::QueryPlanCheck::run(db) > 0 ? 1 : 0);
+        });
+        return app->exec();
+    }
 
     Gibrievida::Configuration config;
     if (!config.language().isEmpty()) {
@@ -148,6 +182,7 @@ int main(int argc, char *argv[])
     qmlRegisterType<Gibrievida::Record>("harbour.gibrievida", 1, 0, "Record");
     qmlRegisterUncreatableType<Gibrievida::RecordsController>("harbour.gibrievida", 1, 0, "RecordsController", QStringLiteral("RecordsController can not be created."));
     qmlRegisterType<Gibrievida::RecordsModel>("harbour.gibrievida", 1, 0, "RecordsModel");
+    qmlRegisterType<Gibrievida::ActivityStatisticsModel>("harbour.gibrievida", 1, 0, "ActivityStatisticsModel");
 
     qmlRegisterType<Gibrievida::LanguagesModel>("harbour.gibrievida", 1, 0, "LanguageModel");
     qmlRegisterType<Gibrievida::LicensesModel>("harbour.gibrievida", 1, 0, "LicensesModel");
@@ -168,17 +203,28 @@ int main(int argc, char *argv[])
     Gibrievida::RecordsController recsController(&config);
     Gibrievida::Helpers *helpers = new Gibrievida::Helpers(&config, QLocale(), app.get());
 
+    Gibrievida::Registry::instance()->setControllers(&catsController, &actsController, &recsController);
+
     view->rootContext()->setContextProperty(QStringLiteral("categories"), &catsController);
     view->rootContext()->setContextProperty(QStringLiteral("activities"), &actsController);
     view->rootContext()->setContextProperty(QStringLiteral("records"), &recsController);
     view->rootContext()->setContextProperty(QStringLiteral("helpers"), helpers);
     view->rootContext()->setContextProperty(QStringLiteral("config"), &config);
+    view->rootContext()->setContextProperty(QStringLiteral("migration"), migration);
     view->rootContext()->setContextProperty(QStringLiteral("coverIcon"), Hbnsc::getLauncherIcon({86,108,128,150,172}));
 
 #ifndef CLAZY
     view->setSource(SailfishApp::pathToMainQml());
 #endif
 
+#ifdef QT_DEBUG
+    auto firstFrame = std::make_shared<QMetaObject::Connection>();
+    *firstFrame = QObject::connect(view.get(), &QQuickWindow::frameSwapped, app.get(), [firstFrame, &startupTimer] () {
+        QObject::disconnect(*firstFrame);
+        qDebug("First frame after %lli ms", startupTimer.elapsed());
+    });
+#endif
+
     view->show();
 
     return app->exec();
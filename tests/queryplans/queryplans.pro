@@ -0,0 +1,15 @@
+TARGET = tst_queryplans
+
+CONFIG += testcase
+CONFIG += c++11
+CONFIG += c++14
+
+QT += testlib sql multimedia sensors positioning
+
+CONFIG += link_pkgconfig
+PKGCONFIG += sqlite3 zlib
+
+include(../../common/common.pri)
+
+SOURCES += \
+    tst_queryplans.cpp
@@ -0,0 +1,159 @@
+/*
+    Gibrievida - An activity tracker
+    Copyright (C) 2016-2019 Hüssenbergnetz/Matthias Fehring
+    https://github.com/Huessenbergnetz/Gibrievida
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include "../../common/dbmanager.h"
+#include "../../common/queryplancheck.h"
+
+#define TST_CONNECTION_NAME "tst_queryplans"
+
+using namespace Gibrievida;
+
+/*!
+ * \brief Checks the query plans on a database created by the migrations, with and without planner statistics.
+ */
+class TestQueryPlans : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void migrationStatistics();
+    void noStatistics();
+    void filledStatistics();
+
+private:
+    QSqlDatabase reopen();
+    void close();
+
+    QTemporaryDir m_dir;
+    QString m_path;
+};
+
+
+void TestQueryPlans::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_path = m_dir.filePath(QStringLiteral("gibrievida.sqlite"));
+    QVERIFY(DBManager::upgrade(m_path));
+}
+
+
+void TestQueryPlans::cleanupTestCase()
+{
+    close();
+}
+
+
+void TestQueryPlans::close()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(QStringLiteral(TST_CONNECTION_NAME), false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral(TST_CONNECTION_NAME));
+}
+
+
+/*!
+ * \brief Opens a new connection, so the planner reads the current statistics.
+ */
+QSqlDatabase TestQueryPlans::reopen()
+{
+    close();
+
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral(TST_CONNECTION_NAME));
+    db.setDatabaseName(m_path);
+    db.open();
+    return db;
+}
+
+
+/*!
+ * \brief Statistics of a fresh installation, the ANALYZE of the migration ran on the empty database.
+ */
+void TestQueryPlans::migrationStatistics()
+{
+    QSqlDatabase db = reopen();
+    QVERIFY(db.isOpen());
+    QCOMPARE(QueryPlanCheck::run(db), 0);
+}
+
+
+void TestQueryPlans::noStatistics()
+{
+    {
+        QSqlDatabase db = reopen();
+        QVERIFY(db.isOpen());
+        QSqlQuery q(db);
+        QVERIFY2(q.exec(QStringLiteral("DELETE FROM sqlite_stat1")), qPrintable(q.lastError().text()));
+    }
+
+    QSqlDatabase db = reopen();
+    QVERIFY(db.isOpen());
+    QCOMPARE(QueryPlanCheck::run(db), 0);
+}
+
+
+void TestQueryPlans::filledStatistics()
+{
+    {
+        QSqlDatabase db = reopen();
+        QVERIFY(db.isOpen());
+        QVERIFY(db.transaction());
+
+        QSqlQuery q(db);
+
+        for (int c = 1; c <= 5; ++c) {
+            QVERIFY(q.exec(QStringLiteral("INSERT INTO categories (id, name, color) VALUES (%1, 'Category %1', '#ff0000')").arg(c)));
+        }
+
+        for (int a = 1; a <= 30; ++a) {
+            QVERIFY(q.exec(QStringLiteral("INSERT INTO activities (id, category, name, minrepeats, maxrepeats, distance) VALUES (%1, %2, 'Activity %1', 0, 0, 0)").arg(a).arg(a % 5 + 1)));
+        }
+
+        QVERIFY(q.prepare(QStringLiteral("INSERT INTO records (activity, start, end, duration, repetitions, distance) VALUES (?, ?, ?, ?, ?, ?)")));
+
+        for (int r = 0; r < 5000; ++r) {
+            q.addBindValue(r % 30 + 1);
+            q.addBindValue(r * 3600);
+            q.addBindValue(r * 3600 + 1800);
+            q.addBindValue(r % 97 * 60);
+            q.addBindValue(r % 3 == 0 ? 0 : r % 50);
+            q.addBindValue(r % 2 == 0 ? 0.0 : r % 41 * 100.0);
+            QVERIFY2(q.exec(), qPrintable(q.lastError().text()));
+        }
+
+        QVERIFY(db.commit());
+        QVERIFY(q.exec(QStringLiteral("ANALYZE")));
+    }
+
+    QSqlDatabase db = reopen();
+    QVERIFY(db.isOpen());
+    QCOMPARE(QueryPlanCheck::run(db), 0);
+}
+
+
+QTEST_GUILESS_MAIN(TestQueryPlans)
+
+#include "tst_queryplans.moc"